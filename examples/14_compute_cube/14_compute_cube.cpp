@@ -97,88 +97,98 @@ int main() {
     imr::Context context;
     imr::Device device(context);
     imr::Swapchain swapchain(device, window);
+    // presents leave the render thread too, which then only waits for free swapchain images
+    swapchain.asyncPresent = true;
     imr::FpsCounter fps_counter;
     imr::ComputePipeline shader(device, "14_compute_cube.spv");
 
     auto cube = make_cube();
 
+    // the simulation prepares a snapshot of the next frame on the main thread while the render thread records the previous one
+    struct Snapshot {
+        Tri triangles[12];
+        float time;
+    };
+    Snapshot snapshots[imr::FrameLoop::snapshot_count];
+
     auto& vk = device.dispatch;
-    while (!glfwWindowShouldClose(window)) {
+    imr::FrameLoop frame_loop(swapchain, window);
+    frame_loop.run([&](uint32_t slot, double delta) {
         fps_counter.tick();
         fps_counter.updateGlfwWindowTitle(window);
 
-        swapchain.renderFrameSimplified([&](imr::Swapchain::SimplifiedRenderContext& context) {
-            auto& image = context.image();
-            auto cmdbuf = context.cmdbuf();
-
-            vk.cmdClearColorImage(cmdbuf, image.handle(), VK_IMAGE_LAYOUT_GENERAL, tmpPtr((VkClearColorValue) {
-                .float32 = { 0.0f, 0.0f, 0.0f, 1.0f },
-            }), 1, tmpPtr(image.whole_image_subresource_range()));
-
-            // This barrier ensures that the clear is finished before we run the dispatch.
-            // before: all writes from the "transfer" stage (to which the clear command belongs)
-            // after: all writes from the "compute" stage
-            vk.cmdPipelineBarrier2(cmdbuf, tmpPtr((VkDependencyInfo) {
-                .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-                .dependencyFlags = 0,
-                .memoryBarrierCount = 1,
-                .pMemoryBarriers = tmpPtr((VkMemoryBarrier2) {
-                    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
-                    .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                    .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-                    .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
-                })
-            }));
-
-            vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, shader.pipeline());
-            auto shader_bind_helper = shader.create_bind_helper();
-            shader_bind_helper->set_storage_image(0, 0, image);
-            shader_bind_helper->commit(cmdbuf);
-
-            // update the push constant data on the host...
-            mat4 m = identity_mat4;
-            mat4 flip_y = identity_mat4;
-            flip_y.rows[1][1] = -1;
-            m = m * flip_y;
-            m = m * rotate_axis_mat4(0, 0.2f);
-            m = m * rotate_axis_mat4(1, push_constants.time);
-            m = m * translate_mat4(vec3(-0.5, -0.5f, -0.5f));
-            push_constants.time = ((imr_get_time_nano() / 1000) % 10000000000) / 1000000.0f;
-
-            // draw all 12 triangles using 12 separate dispatches
-            for (int i = 0; i < 12; i++) {
-                auto tri = cube.triangles[i];
-                Tri transformed;
-                auto transform = [&](vec3 input) -> vec3 {
-                    vec4 v = vec4(input, 1);
-                    v = m * v;
-                    v.xyz = vec3(v.xyz) / (float) v.w;
-                    return v.xyz;
-                };
-                transformed.v0 = transform(tri.v0);
-                transformed.v1 = transform(tri.v1);
-                transformed.v2 = transform(tri.v2);
-                transformed.color = tri.color;
-
-                push_constants.tri = transformed;
-                push_constants.time = ((imr_get_time_nano() / 1000) % 10000000000) / 1000000.0f;
-                // copy it to the command buffer!
-                vkCmdPushConstants(cmdbuf, shader.layout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
-
-                // dispatch like before
-                vkCmdDispatch(cmdbuf, (image.size().width + 31) / 32, (image.size().height + 31) / 32, 1);
-
-                // EXERCISE: are we missing something here ?
-            }
-
-            context.addCleanupAction([=, &device]() {
-                delete shader_bind_helper;
-            });
+        auto& snapshot = snapshots[slot];
+        snapshot.time = ((imr_get_time_nano() / 1000) % 10000000000) / 1000000.0f;
+
+        mat4 m = identity_mat4;
+        mat4 flip_y = identity_mat4;
+        flip_y.rows[1][1] = -1;
+        m = m * flip_y;
+        m = m * rotate_axis_mat4(0, 0.2f);
+        m = m * rotate_axis_mat4(1, snapshot.time);
+        m = m * translate_mat4(vec3(-0.5, -0.5f, -0.5f));
+
+        auto transform = [&](vec3 input) -> vec3 {
+            vec4 v = vec4(input, 1);
+            v = m * v;
+            v.xyz = vec3(v.xyz) / (float) v.w;
+            return v.xyz;
+        };
+        for (int i = 0; i < 12; i++) {
+            auto tri = cube.triangles[i];
+            Tri& transformed = snapshot.triangles[i];
+            transformed.v0 = transform(tri.v0);
+            transformed.v1 = transform(tri.v1);
+            transformed.v2 = transform(tri.v2);
+            transformed.color = tri.color;
+        }
+    }, [&](uint32_t slot, imr::Swapchain::SimplifiedRenderContext& context) {
+        auto& snapshot = snapshots[slot];
+        auto& image = context.image();
+        auto cmdbuf = context.cmdbuf();
+
+        vk.cmdClearColorImage(cmdbuf, image.handle(), VK_IMAGE_LAYOUT_GENERAL, tmpPtr((VkClearColorValue) {
+            .float32 = { 0.0f, 0.0f, 0.0f, 1.0f },
+        }), 1, tmpPtr(image.whole_image_subresource_range()));
+
+        // This barrier ensures that the clear is finished before we run the dispatch.
+        // before: all writes from the "transfer" stage (to which the clear command belongs)
+        // after: all writes from the "compute" stage
+        vk.cmdPipelineBarrier2(cmdbuf, tmpPtr((VkDependencyInfo) {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .dependencyFlags = 0,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = tmpPtr((VkMemoryBarrier2) {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            })
+        }));
+
+        vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, shader.pipeline());
+        auto shader_bind_helper = shader.create_bind_helper();
+        shader_bind_helper->set_storage_image(0, 0, image);
+        shader_bind_helper->commit(cmdbuf);
+
+        // draw all 12 triangles using 12 separate dispatches
+        for (int i = 0; i < 12; i++) {
+            // the snapshot already has them transformed, just copy them to the command buffer!
+            push_constants.tri = snapshot.triangles[i];
+            push_constants.time = snapshot.time;
+            vkCmdPushConstants(cmdbuf, shader.layout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants), &push_constants);
+
+            // dispatch like before
+            vkCmdDispatch(cmdbuf, (image.size().width + 31) / 32, (image.size().height + 31) / 32, 1);
+
+            // EXERCISE: are we missing something here ?
+        }
+
+        context.addCleanupAction([=, &device]() {
+            delete shader_bind_helper;
         });
-
-        glfwPollEvents();
-    }
+    });
 
     swapchain.drain();
     return 0;
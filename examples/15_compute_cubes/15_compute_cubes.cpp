@@ -1,6 +1,7 @@
 #include "imr/imr.h"
 #include "imr/util.h"
 
+#include <algorithm>
 #include <cmath>
 #include "nasl/nasl.h"
 #include "nasl/nasl_mat.h"
@@ -108,13 +109,29 @@ struct {
     uint32_t instances_count;
     VkDeviceAddress preprocessed_tri_buffer;
     float time;
+    uint32_t viewport[2];
+    uint32_t subpixel_bits;
+    VkDeviceAddress uncompressed_tri_buffer;
 } push_constants_pipelined_vert;
 
 struct {
     VkDeviceAddress preprocessed_tri_buffer;
     uint32_t tri_count;
+    VkDeviceAddress uncompressed_tri_buffer;
 } push_constants_pipelined_frag;
 
+struct {
+    VkDeviceAddress preprocessed_tri_buffer;
+    uint32_t tri_count;
+    VkDeviceAddress visibility_buffer;
+    uint32_t size[2];
+} push_constants_visibility_raster;
+
+struct {
+    VkDeviceAddress preprocessed_tri_buffer;
+    VkDeviceAddress visibility_buffer;
+} push_constants_visibility_resolve;
+
 Camera camera;
 CameraFreelookState camera_state = {
     .fly_speed = 1.0f,
@@ -133,34 +150,103 @@ enum TriDrawMode {
     BATCHED,
     INSTANCED,
     PIPELINED,
+    /// Like PIPELINED, but rasterizes only depth and triangle IDs (one 64-bit atomicMin per fragment), then shades each pixel once in a resolve pass
+    VISIBILITY,
 };
 
+// plain arrays so the layout matches the shaders' scalar layout, the validation mode reads these back
 struct PreprocessedTri {
-    vec4 v0;
-    vec4 v1;
-    vec4 v2;
-    vec2 ss_v0;
-    vec2 ss_v1;
-    vec2 ss_v2;
-    vec3 color;
+    float v0[4];
+    float v1[4];
+    float v2[4];
+    float ss_v0[2];
+    float ss_v1[2];
+    float ss_v2[2];
+    float color[3];
+    // fixed-point edge equations, bounding box and 1/area from the triangle setup pass
+    int32_t edge_a[3];
+    int32_t edge_b[3];
+    int64_t edge_c[3];
+    float inv_area;
+    int32_t bbox[4];
+    uint32_t flags;
+};
+static_assert(sizeof(PreprocessedTri) == 160);
+
+/// What --compact passes between the pipelined stages: 16.8 fixed-point pixel positions, fp16 1/w, and RGBA8 with the flags in the alpha byte.
+/// Triangles that don't fit are flagged TRI_UNCOMPRESSED and written in full to the uncompressed buffer at the same index instead.
+struct CompactTri {
+    int16_t position_hi[3][2];
+    uint8_t position_lo[3][2];
+    uint16_t inv_w[3];
+    uint32_t color;
 };
+static_assert(sizeof(CompactTri) == 28);
+
+#define TRI_UNCOMPRESSED 4
 
 TriDrawMode mode = SINGLE;
+bool compact = false;
+bool validate_compact = false;
+uint32_t subpixel_bits = 8;
+
+static float half_to_float(uint16_t h) {
+    int exponent = (h >> 10) & 0x1F;
+    int mantissa = h & 0x3FF;
+    float magnitude;
+    if (exponent == 0)
+        magnitude = std::ldexp((float) mantissa, -24);
+    else if (exponent == 31)
+        magnitude = mantissa ? NAN : INFINITY;
+    else
+        magnitude = std::ldexp((float) (mantissa | 0x400), exponent - 25);
+    return (h & 0x8000) ? -magnitude : magnitude;
+}
+
+/// The instanced and pipelined raster kernels compact their triangle batches with these, Vulkan doesn't guarantee them in compute shaders
+static bool has_subgroup_ballot(imr::Device& d) {
+    return d.compute_capabilities().supports(VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_BALLOT_BIT);
+}
 
 struct Shaders {
     imr::ComputePipeline single;
     imr::ComputePipeline batched;
+    /// Without subgroup ballots, the triangle batches aren't compacted
     imr::ComputePipeline instanced;
-    imr::ComputePipeline pipelined_triangles;
-    imr::ComputePipeline pipelined_raster;
+    /// Without 64-bit integers, these skip the fixed-point edge equations and rasterize in floating point.
+    /// The raster stage falls back to that as well without subgroup ballots.
+    std::unique_ptr<imr::ComputePipeline> pipelined_triangles;
+    std::unique_ptr<imr::ComputePipeline> pipelined_raster;
+    /// Also needs subgroup ballots and 8- and 16-bit storage
+    std::unique_ptr<imr::ComputePipeline> pipelined_triangles_compact;
+    std::unique_ptr<imr::ComputePipeline> pipelined_raster_compact;
+    /// Only on devices with 64-bit buffer atomics
+    std::unique_ptr<imr::ComputePipeline> visibility_raster;
+    std::unique_ptr<imr::ComputePipeline> visibility_resolve;
 
     Shaders(imr::Device& d) :
         single(d, "15_compute_cubes.spv"),
         batched(d, "15_compute_cubes_batched.spv"),
-        instanced(d, "15_compute_cubes_instanced.spv"),
-        pipelined_triangles(d, "15_compute_cubes_pipelined_triangles.spv"),
-        pipelined_raster(d, "15_compute_cubes_pipelined_raster.spv")
-        {}
+        instanced(d, has_subgroup_ballot(d) ? "15_compute_cubes_instanced.spv" : "15_compute_cubes_instanced_fallback.spv")
+    {
+        if (d.features().shader_int64)
+            pipelined_triangles = std::make_unique<imr::ComputePipeline>(d, "15_compute_cubes_pipelined_triangles.spv");
+        else
+            pipelined_triangles = std::make_unique<imr::ComputePipeline>(d, "15_compute_cubes_pipelined_triangles_fallback.spv");
+        // the fallback ignores the edge equations, but has the same PreprocessedTri layout
+        if (d.features().shader_int64 && has_subgroup_ballot(d))
+            pipelined_raster = std::make_unique<imr::ComputePipeline>(d, "15_compute_cubes_pipelined_raster.spv");
+        else
+            pipelined_raster = std::make_unique<imr::ComputePipeline>(d, "15_compute_cubes_pipelined_raster_fallback.spv");
+        if (d.features().shader_int64 && has_subgroup_ballot(d) && d.features().storage_buffer_8bit && d.features().storage_buffer_16bit) {
+            pipelined_triangles_compact = std::make_unique<imr::ComputePipeline>(d, "15_compute_cubes_pipelined_triangles_compact.spv");
+            pipelined_raster_compact = std::make_unique<imr::ComputePipeline>(d, "15_compute_cubes_pipelined_raster_compact.spv");
+        }
+        if (d.features().shader_int64 && d.features().buffer_int64_atomics) {
+            visibility_raster = std::make_unique<imr::ComputePipeline>(d, "15_compute_cubes_visibility_raster.spv");
+            visibility_resolve = std::make_unique<imr::ComputePipeline>(d, "15_compute_cubes_visibility_resolve.spv");
+        }
+    }
 };
 
 int main(int argc, char** argv) {
@@ -174,6 +260,19 @@ int main(int argc, char** argv) {
         if (strcmp(argv[i], "--pipelined") == 0) {
             mode = PIPELINED;
         }
+        if (strcmp(argv[i], "--visibility") == 0) {
+            mode = VISIBILITY;
+        }
+        if (strcmp(argv[i], "--compact") == 0) {
+            compact = true;
+        }
+        if (strcmp(argv[i], "--validate-compact") == 0) {
+            compact = true;
+            validate_compact = true;
+        }
+        if (strcmp(argv[i], "--subpixel-bits") == 0 && i + 1 < argc) {
+            subpixel_bits = atoi(argv[++i]);
+        }
     }
 
     glfwInit();
@@ -187,6 +286,22 @@ int main(int argc, char** argv) {
 
     imr::Context context;
     imr::Device device(context);
+    if (mode == VISIBILITY && !(device.features().shader_int64 && device.features().buffer_int64_atomics)) {
+        fprintf(stderr, "--visibility needs 64-bit integers and buffer atomics\n");
+        return 1;
+    }
+    if (compact && mode != PIPELINED) {
+        fprintf(stderr, "--compact only applies to --pipelined\n");
+        return 1;
+    }
+    if (compact && !(device.features().shader_int64 && has_subgroup_ballot(device) && device.features().storage_buffer_8bit && device.features().storage_buffer_16bit)) {
+        fprintf(stderr, "--compact needs 64-bit integers, subgroup ballots in compute shaders and 8- and 16-bit storage buffers\n");
+        return 1;
+    }
+    if (subpixel_bits > 8) {
+        fprintf(stderr, "--subpixel-bits must be between 0 and 8\n");
+        return 1;
+    }
     imr::Swapchain swapchain(device, window);
     imr::FpsCounter fps_counter;
     auto shaders = std::make_unique<Shaders>(device);
@@ -194,22 +309,94 @@ int main(int argc, char** argv) {
     auto cube = make_cube();
 
     std::unique_ptr<imr::Buffer> triangles_buffer;
-    if (mode == BATCHED || mode == INSTANCED || mode == PIPELINED) {
+    if (mode == BATCHED || mode == INSTANCED || mode == PIPELINED || mode == VISIBILITY) {
         triangles_buffer = std::make_unique<imr::Buffer>(device, sizeof(cube.triangles), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
         triangles_buffer->uploadDataSync(0, sizeof(cube.triangles), cube.triangles);
     }
 
-    std::unique_ptr<imr::Buffer> matrices_buffer;
-    if (mode == INSTANCED || mode == PIPELINED) {
-        matrices_buffer = std::make_unique<imr::Buffer>(device, sizeof(nasl::mat4) * INSTANCES_COUNT, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    // the modes reading their matrices from a buffer get them late-latched: the camera is read after the frame is submitted, while the GPU waits for it
+    bool late_latch = mode == INSTANCED || mode == PIPELINED || mode == VISIBILITY;
+    std::unique_ptr<imr::LatchedConstants> latched_matrices;
+    if (late_latch) {
+        latched_matrices = std::make_unique<imr::LatchedConstants>(device, sizeof(nasl::mat4) * INSTANCES_COUNT);
     }
 
     std::unique_ptr<imr::Buffer> tmp_buffer;
-    if (mode == PIPELINED) {
-        // we're never writing to this from the host
-        tmp_buffer = std::make_unique<imr::Buffer>(device, sizeof(PreprocessedTri) * INSTANCES_COUNT * 12, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+    std::unique_ptr<imr::Buffer> compact_buffer;
+    // we're never writing to these from the host, but validation reads both back
+    VkMemoryPropertyFlags tmp_memory = validate_compact ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if (mode == PIPELINED || mode == VISIBILITY) {
+        tmp_buffer = std::make_unique<imr::Buffer>(device, sizeof(PreprocessedTri) * INSTANCES_COUNT * 12, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, tmp_memory);
+    }
+    if (compact) {
+        compact_buffer = std::make_unique<imr::Buffer>(device, sizeof(CompactTri) * INSTANCES_COUNT * 12, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, tmp_memory);
     }
 
+    struct {
+        size_t checked = 0;
+        size_t out_of_tolerance = 0;
+        size_t uncompressed = 0;
+        float max_position_error = 0;
+        float max_inv_w_error = 0;
+        float max_color_error = 0;
+    } validation;
+
+    // compares what the compact pass wrote against the full-precision pass of the same frame
+    auto validate = [&](VkExtent3D size) {
+        auto full = static_cast<PreprocessedTri*>(tmp_buffer->map());
+        auto packed = static_cast<CompactTri*>(compact_buffer->map());
+        float position_tolerance = 0.5f / float(1 << subpixel_bits) + 1.0f / 256.0f;
+        for (size_t i = 0; i < INSTANCES_COUNT * 12; i++) {
+            auto& f = full[i];
+            auto& c = packed[i];
+            const float* v[3] = { f.v0, f.v1, f.v2 };
+            const float* ss[3] = { f.ss_v0, f.ss_v1, f.ss_v2 };
+
+            bool encodable = true;
+            float pixels[3][2];
+            for (int j = 0; j < 3; j++) {
+                for (int k = 0; k < 2; k++) {
+                    pixels[j][k] = (ss[j][k] + 1.0f) * 0.5f * float(k == 0 ? size.width : size.height);
+                    encodable &= std::abs(pixels[j][k]) < 32768.0f;
+                    // same rounding as the shader, which can carry past the 16 integer bits
+                    float fixed_point = std::round(pixels[j][k] * float(1 << subpixel_bits)) * float(1 << (8 - subpixel_bits));
+                    encodable &= fixed_point >= -8388608.0f && fixed_point <= 8388607.0f;
+                }
+                encodable &= v[j][3] > 0.0f && 1.0f / v[j][3] <= 65504.0f;
+            }
+
+            bool uncompressed = (c.color >> 24) & TRI_UNCOMPRESSED;
+            bool ok = uncompressed == !encodable;
+            validation.uncompressed += uncompressed;
+            if (encodable && !uncompressed) {
+                for (int j = 0; j < 3; j++) {
+                    for (int k = 0; k < 2; k++) {
+                        float decoded = float((int32_t(c.position_hi[j][k]) << 8) | c.position_lo[j][k]) / 256.0f;
+                        float error = std::abs(decoded - pixels[j][k]);
+                        validation.max_position_error = std::max(validation.max_position_error, error);
+                        ok &= error <= position_tolerance;
+                    }
+                    float inv_w = 1.0f / v[j][3];
+                    float error = std::abs(half_to_float(c.inv_w[j]) - inv_w) / inv_w;
+                    validation.max_inv_w_error = std::max(validation.max_inv_w_error, error);
+                    ok &= error <= 1.0f / 1024.0f;
+                }
+                for (int k = 0; k < 3; k++) {
+                    float decoded = float((c.color >> (k * 8)) & 0xFF) / 255.0f;
+                    float error = std::abs(decoded - std::clamp(f.color[k], 0.0f, 1.0f));
+                    validation.max_color_error = std::max(validation.max_color_error, error);
+                    ok &= error <= 0.5f / 255.0f + 1e-5f;
+                }
+            }
+
+            validation.checked++;
+            if (!ok && validation.out_of_tolerance++ < 16)
+                fprintf(stderr, "compact triangle %zu is out of tolerance (uncompressed: %d, encodable: %d)\n", i, uncompressed, encodable);
+        }
+        compact_buffer->unmap();
+        tmp_buffer->unmap();
+    };
+
     std::vector<vec3> positions;
 
     for (size_t i = 0; i < INSTANCES_COUNT; i++) {
@@ -226,15 +413,47 @@ int main(int argc, char** argv) {
     camera = {{0, 0, 3}, {0, 0}, 60};
 
     std::unique_ptr<imr::Image> depthBuffer;
+    std::unique_ptr<imr::Buffer> visibilityBuffer;
+
+    auto view_matrix = [&](VkExtent3D size) {
+        mat4 m = identity_mat4;
+        mat4 flip_y = identity_mat4;
+        flip_y.rows[1][1] = -1;
+        m = m * flip_y;
+        mat4 view_mat = camera_get_view_mat4(&camera, size.width, size.height);
+        m = m * view_mat;
+        m = m * translate_mat4(vec3(-0.5, -0.5f, -0.5f));
+        return m;
+    };
+
+    auto instance_matrices = [&](VkExtent3D size) {
+        mat4 m = view_matrix(size);
+        std::vector<mat4> matrices;
+        for (auto pos : positions) {
+            mat4 cube_matrix = m;
+            cube_matrix = cube_matrix * translate_mat4(pos);
+            matrices.push_back(cube_matrix);
+        }
+        return matrices;
+    };
+
+    auto update_delta = [&]() {
+        auto now = imr_get_time_nano();
+        delta = ((float) ((now - prev_frame) / 1000L)) / 1000000.0f;
+        prev_frame = now;
+    };
 
     auto& vk = device.dispatch;
     while (!glfwWindowShouldClose(window)) {
         fps_counter.tick();
         fps_counter.updateGlfwWindowTitle(window);
 
+        VkExtent3D frame_size = {};
         swapchain.renderFrameSimplified([&](imr::Swapchain::SimplifiedRenderContext& context) {
-            camera_update(window, &camera_input);
-            camera_move_freelook(&camera, &camera_input, &camera_state, delta);
+            if (!late_latch) {
+                camera_update(window, &camera_input);
+                camera_move_freelook(&camera, &camera_input, &camera_state, delta);
+            }
 
             if (reload_shaders) {
                 swapchain.drain();
@@ -244,6 +463,7 @@ int main(int argc, char** argv) {
 
             auto& image = context.image();
             auto cmdbuf = context.cmdbuf();
+            frame_size = image.size();
 
             if (!depthBuffer || depthBuffer->size().width != context.image().size().width || depthBuffer->size().height != context.image().size().height) {
                 VkImageUsageFlagBits depthBufferFlags = static_cast<VkImageUsageFlagBits>(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
@@ -271,9 +491,21 @@ int main(int argc, char** argv) {
                 .float32 = { 0.0f, 0.0f, 0.0f, 1.0f },
             }), 1, tmpPtr(image.whole_image_subresource_range()));
 
-            vk.cmdClearColorImage(cmdbuf, depthBuffer->handle(), VK_IMAGE_LAYOUT_GENERAL, tmpPtr((VkClearColorValue) {
-                .float32 = { 1.0f, 0.0f, 0.0f, 0.0f },
-            }), 1, tmpPtr(depthBuffer->whole_image_subresource_range()));
+            VkExtent3D size = image.size();
+            if (mode == VISIBILITY && (!visibilityBuffer || visibilityBuffer->size != size_t(size.width) * size.height * sizeof(uint64_t))) {
+                if (visibilityBuffer)
+                    swapchain.drain();
+                visibilityBuffer = std::make_unique<imr::Buffer>(device, size_t(size.width) * size.height * sizeof(uint64_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+            }
+            // all ones is as far as it gets, and no triangle
+            if (mode == VISIBILITY)
+                vkCmdFillBuffer(cmdbuf, visibilityBuffer->handle, 0, VK_WHOLE_SIZE, 0xFFFFFFFF);
+
+            if (mode != VISIBILITY) {
+                vk.cmdClearColorImage(cmdbuf, depthBuffer->handle(), VK_IMAGE_LAYOUT_GENERAL, tmpPtr((VkClearColorValue) {
+                    .float32 = { 1.0f, 0.0f, 0.0f, 0.0f },
+                }), 1, tmpPtr(depthBuffer->whole_image_subresource_range()));
+            }
 
             // This barrier ensures that the clear is finished before we run the dispatch.
             // before: all writes from the "transfer" stage (to which the clear command belongs)
@@ -287,7 +519,7 @@ int main(int argc, char** argv) {
                     .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
                     .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
                     .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-                    .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                    .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
                 })
             }));
 
@@ -307,18 +539,12 @@ int main(int argc, char** argv) {
             };
 
             // update the push constant data on the host...
-            mat4 m = identity_mat4;
-            mat4 flip_y = identity_mat4;
-            flip_y.rows[1][1] = -1;
-            m = m * flip_y;
-            mat4 view_mat = camera_get_view_mat4(&camera, context.image().size().width, context.image().size().height);
-            m = m * view_mat;
-            m = m * translate_mat4(vec3(-0.5, -0.5f, -0.5f));
+            mat4 m = view_matrix(context.image().size());
 
             switch (mode) {
                 case SINGLE: {
                     auto& shader = shaders->single;
-                    vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, shader.pipeline());
+                    shader.bind(cmdbuf);
                     auto shader_bind_helper = shader.create_bind_helper();
                     shader_bind_helper->set_storage_image(0, 0, image);
                     shader_bind_helper->set_storage_image(0, 1, *depthBuffer);
@@ -337,11 +563,8 @@ int main(int argc, char** argv) {
 
                             push_constants_single.tri = tri;
                             push_constants_single.matrix = cube_matrix;
-                            // copy it to the command buffer!
-                            vkCmdPushConstants(cmdbuf, shader.layout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants_single), &push_constants_single);
-
-                            // dispatch like before
-                            vkCmdDispatch(cmdbuf, (image.size().width + 31) / 32, (image.size().height + 31) / 32, 1);
+                            // copy what changed to the command buffer, and dispatch like before
+                            shader.dispatch(cmdbuf, push_constants_single, image.size());
                         }
                     }
 
@@ -352,7 +575,7 @@ int main(int argc, char** argv) {
                 }
                 case BATCHED: {
                     auto& shader = shaders->batched;
-                    vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, shader.pipeline());
+                    shader.bind(cmdbuf);
                     auto shader_bind_helper = shader.create_bind_helper();
                     shader_bind_helper->set_storage_image(0, 0, image);
                     shader_bind_helper->set_storage_image(0, 1, *depthBuffer);
@@ -371,15 +594,14 @@ int main(int argc, char** argv) {
 
                         push_constants_batched.matrix = cube_matrix;
 
-                        vkCmdPushConstants(cmdbuf, shader.layout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants_batched), &push_constants_batched);
-                        vkCmdDispatch(cmdbuf, (image.size().width + 31) / 32, (image.size().height + 31) / 32, 1);
+                        shader.dispatch(cmdbuf, push_constants_batched, image.size());
                     }
 
                     break;
                 }
                 case INSTANCED: {
                     auto& shader = shaders->instanced;
-                    vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, shader.pipeline());
+                    shader.bind(cmdbuf);
                     auto shader_bind_helper = shader.create_bind_helper();
                     shader_bind_helper->set_storage_image(0, 0, image);
                     shader_bind_helper->set_storage_image(0, 1, *depthBuffer);
@@ -390,76 +612,146 @@ int main(int argc, char** argv) {
                     push_constants_instanced.tri_buffer = triangles_buffer->device_address();
                     push_constants_instanced.tri_count = 12;
 
-                    std::vector<mat4> matrices;
-                    for (auto pos : positions) {
-                        mat4 cube_matrix = m;
-                        cube_matrix = cube_matrix * translate_mat4(pos);
-                        matrices.push_back(cube_matrix);
-                    }
-                    matrices_buffer->uploadDataSync(0, sizeof(mat4) * matrices.size(), matrices.data());
-
-                    push_constants_instanced.matrices_buffer = matrices_buffer->device_address();
-                    push_constants_instanced.instances_count = matrices.size();
+                    push_constants_instanced.matrices_buffer = latched_matrices->begin_frame(context.frame());
+                    push_constants_instanced.instances_count = positions.size();
 
                     add_render_barrier();
+                    latched_matrices->defer(cmdbuf);
 
-                    vkCmdPushConstants(cmdbuf, shader.layout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants_instanced), &push_constants_instanced);
-                    vkCmdDispatch(cmdbuf, (image.size().width + 31) / 32, (image.size().height + 31) / 32, 1);
+                    shader.dispatch(cmdbuf, push_constants_instanced, image.size());
                     break;
                 }
                 case PIPELINED: {
-                    auto& triangle_transform_shader = shaders->pipelined_triangles;
-                    vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, triangle_transform_shader.pipeline());
+                    auto& triangle_transform_shader = *shaders->pipelined_triangles;
+                    triangle_transform_shader.bind(cmdbuf);
 
                     push_constants_pipelined_vert.time = ((imr_get_time_nano() / 1000) % 10000000000) / 1000000.0f;
                     // the cube data is the same for all
                     push_constants_pipelined_vert.tri_buffer = triangles_buffer->device_address();
                     push_constants_pipelined_vert.tri_count = 12;
 
-                    std::vector<mat4> matrices;
-                    for (auto pos : positions) {
-                        mat4 cube_matrix = m;
-                        cube_matrix = cube_matrix * translate_mat4(pos);
-                        matrices.push_back(cube_matrix);
-                    }
-                    matrices_buffer->uploadDataSync(0, sizeof(mat4) * matrices.size(), matrices.data());
-
-                    push_constants_pipelined_vert.matrices_buffer = matrices_buffer->device_address();
-                    push_constants_pipelined_vert.instances_count = matrices.size();
+                    push_constants_pipelined_vert.matrices_buffer = latched_matrices->begin_frame(context.frame());
+                    push_constants_pipelined_vert.instances_count = positions.size();
                     push_constants_pipelined_vert.preprocessed_tri_buffer = tmp_buffer->device_address();
+                    push_constants_pipelined_vert.viewport[0] = image.size().width;
+                    push_constants_pipelined_vert.viewport[1] = image.size().height;
+                    push_constants_pipelined_vert.subpixel_bits = subpixel_bits;
+                    // triangles the compact pass can't encode are kept at full size, in the same buffer
+                    push_constants_pipelined_vert.uncompressed_tri_buffer = tmp_buffer->device_address();
 
                     add_render_barrier();
+                    latched_matrices->defer(cmdbuf);
 
-                    vkCmdPushConstants(cmdbuf, triangle_transform_shader.layout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants_pipelined_vert), &push_constants_pipelined_vert);
-                    vkCmdDispatch(cmdbuf, (12 + 31) / 32, (INSTANCES_COUNT + 31) / 32, 1);
+                    // the full-precision pass only runs for the validation to compare against
+                    if (!compact || validate_compact)
+                        triangle_transform_shader.dispatch(cmdbuf, push_constants_pipelined_vert, { 12, INSTANCES_COUNT, 1 });
+
+                    if (compact) {
+                        // both passes write the unencodable triangles to tmp_buffer
+                        if (validate_compact)
+                            add_render_barrier();
+                        auto& compact_shader = *shaders->pipelined_triangles_compact;
+                        compact_shader.bind(cmdbuf);
+                        push_constants_pipelined_vert.preprocessed_tri_buffer = compact_buffer->device_address();
+                        compact_shader.dispatch(cmdbuf, push_constants_pipelined_vert, { 12, INSTANCES_COUNT, 1 });
+                    }
 
                     add_render_barrier();
 
-                    auto& rasterizer_shader = shaders->pipelined_raster;
-                    vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, rasterizer_shader.pipeline());
+                    auto& rasterizer_shader = compact ? *shaders->pipelined_raster_compact : *shaders->pipelined_raster;
+                    rasterizer_shader.bind(cmdbuf);
                     auto shader_bind_helper = rasterizer_shader.create_bind_helper();
                     shader_bind_helper->set_storage_image(0, 0, image);
                     shader_bind_helper->set_storage_image(0, 1, *depthBuffer);
                     shader_bind_helper->commit(cmdbuf);
 
-                    push_constants_pipelined_frag.preprocessed_tri_buffer = tmp_buffer->device_address();
+                    push_constants_pipelined_frag.preprocessed_tri_buffer = compact ? compact_buffer->device_address() : tmp_buffer->device_address();
                     push_constants_pipelined_frag.tri_count = INSTANCES_COUNT * 12;
+                    push_constants_pipelined_frag.uncompressed_tri_buffer = tmp_buffer->device_address();
 
-                    vkCmdPushConstants(cmdbuf, rasterizer_shader.layout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants_pipelined_frag), &push_constants_pipelined_frag);
+                    // every invocation rasterizes a run of 4 pixels
+                    rasterizer_shader.dispatch(cmdbuf, push_constants_pipelined_frag, { (image.size().width + 3) / 4, image.size().height, 1 });
+                    break;
+                }
+                case VISIBILITY: {
+                    auto& triangle_transform_shader = *shaders->pipelined_triangles;
+                    triangle_transform_shader.bind(cmdbuf);
+
+                    push_constants_pipelined_vert.time = ((imr_get_time_nano() / 1000) % 10000000000) / 1000000.0f;
+                    push_constants_pipelined_vert.tri_buffer = triangles_buffer->device_address();
+                    push_constants_pipelined_vert.tri_count = 12;
 
-                    vkCmdDispatch(cmdbuf, (image.size().width + 31) / 32, (image.size().height + 31) / 32, 1);
+                    push_constants_pipelined_vert.matrices_buffer = latched_matrices->begin_frame(context.frame());
+                    push_constants_pipelined_vert.instances_count = positions.size();
+                    push_constants_pipelined_vert.preprocessed_tri_buffer = tmp_buffer->device_address();
+                    push_constants_pipelined_vert.viewport[0] = image.size().width;
+                    push_constants_pipelined_vert.viewport[1] = image.size().height;
+
+                    add_render_barrier();
+                    latched_matrices->defer(cmdbuf);
+
+                    triangle_transform_shader.dispatch(cmdbuf, push_constants_pipelined_vert, { 12, INSTANCES_COUNT, 1 });
+
+                    add_render_barrier();
+
+                    // no images here: every triangle gets its own layer of workgroups
+                    auto& raster_shader = *shaders->visibility_raster;
+                    raster_shader.bind(cmdbuf);
+
+                    push_constants_visibility_raster.preprocessed_tri_buffer = tmp_buffer->device_address();
+                    push_constants_visibility_raster.tri_count = INSTANCES_COUNT * 12;
+                    push_constants_visibility_raster.visibility_buffer = visibilityBuffer->device_address();
+                    push_constants_visibility_raster.size[0] = size.width;
+                    push_constants_visibility_raster.size[1] = size.height;
+
+                    raster_shader.dispatch(cmdbuf, push_constants_visibility_raster, { (size.width + 3) / 4, size.height, INSTANCES_COUNT * 12 });
+
+                    add_render_barrier();
+
+                    auto& resolve_shader = *shaders->visibility_resolve;
+                    resolve_shader.bind(cmdbuf);
+                    auto shader_bind_helper = resolve_shader.create_bind_helper();
+                    shader_bind_helper->set_storage_image(0, 0, image);
+                    shader_bind_helper->set_storage_image(0, 1, *depthBuffer);
+                    shader_bind_helper->commit(cmdbuf);
+
+                    push_constants_visibility_resolve.preprocessed_tri_buffer = tmp_buffer->device_address();
+                    push_constants_visibility_resolve.visibility_buffer = visibilityBuffer->device_address();
+
+                    resolve_shader.dispatch(cmdbuf, push_constants_visibility_resolve, image.size());
+
+                    context.addCleanupAction([=]() {
+                        delete shader_bind_helper;
+                    });
                     break;
                 }
             }
 
-            auto now = imr_get_time_nano();
-            delta = ((float) ((now - prev_frame) / 1000L)) / 1000000.0f;
-            prev_frame = now;
+            if (!late_latch) {
+                update_delta();
+                glfwPollEvents();
+            }
+        });
 
+        if (late_latch) {
+            // the frame is submitted and waiting for its matrices: read the input as late as we can
+            update_delta();
             glfwPollEvents();
-        });
+            camera_update(window, &camera_input);
+            camera_move_freelook(&camera, &camera_input, &camera_state, delta);
+            latched_matrices->latch(instance_matrices(frame_size).data());
+        }
+
+        if (validate_compact) {
+            swapchain.drain();
+            validate(frame_size);
+        }
     }
 
     swapchain.drain();
+    if (validate_compact) {
+        printf("compact validation: %zu triangles checked, %zu uncompressed, %zu out of tolerance\n", validation.checked, validation.uncompressed, validation.out_of_tolerance);
+        printf("max errors: position %f px, 1/w %f (relative), color %f\n", validation.max_position_error, validation.max_inv_w_error, validation.max_color_error);
+    }
     return 0;
 }
@@ -2,6 +2,10 @@
 #extension GL_EXT_shader_image_load_formatted : require
 #extension GL_EXT_scalar_block_layout : require
 #extension GL_EXT_buffer_reference : require
+#ifndef NO_SUBGROUP_BALLOT
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_ballot : require
+#endif
 
 layout(set = 0, binding = 0)
 uniform image2D renderTarget;
@@ -13,6 +17,22 @@ layout(local_size_x = 32, local_size_y = 32, local_size_z = 1) in;
 
 struct Tri { vec3 v0, v1, v2; vec3 color; };
 
+// a triangle of an instance, transformed once per workgroup rather than once per pixel
+struct TransformedTri {
+    vec4 v0, v1, v2;
+    vec3 os_v0, os_v1, os_v2;
+    vec3 color;
+};
+
+// this many instance triangles are transformed at a time, and only the ones touching the workgroup's tile are kept
+#define BATCH_SIZE 64
+shared TransformedTri staged[BATCH_SIZE];
+shared uint staged_count;
+#ifdef NO_SUBGROUP_BALLOT
+// without ballots the batch isn't compacted, triangles keep their slot and the rejected ones are skipped
+shared bool staged_overlaps[BATCH_SIZE];
+#endif
+
 #define dvec3 vec3
 #define dvec2 vec2
 #define double float
@@ -61,13 +81,30 @@ bool is_inside_edge(dvec2 e0, dvec2 e1, dvec2 p) {
     return (ey < p.y) ^^ (e0.x > e1.x);
 }
 
-void drawTri(Tri tri, mat4 matrix, dvec2 point) {
-    vec4 os_v0 = vec4(tri.v0, 1);
-    vec4 os_v1 = vec4(tri.v1, 1);
-    vec4 os_v2 = vec4(tri.v2, 1);
-    vec4 v0 = matrix * os_v0;
-    vec4 v1 = matrix * os_v1;
-    vec4 v2 = matrix * os_v2;
+TransformedTri transformTri(Tri tri, mat4 matrix) {
+    return TransformedTri(matrix * vec4(tri.v0, 1), matrix * vec4(tri.v1, 1), matrix * vec4(tri.v2, 1), tri.v0, tri.v1, tri.v2, tri.color);
+}
+
+// conservative: a pixel is sampled at its corner, so the bounds get a pixel of margin
+bool overlapsTile(TransformedTri tri, vec2 tile_min, vec2 tile_max, vec2 img_size) {
+    // triangles crossing the camera plane don't project to their vertices' bounds
+    if (tri.v0.w <= 0 || tri.v1.w <= 0 || tri.v2.w <= 0)
+        return true;
+    vec2 p0 = (tri.v0.xy / tri.v0.w + vec2(1)) * 0.5 * img_size;
+    vec2 p1 = (tri.v1.xy / tri.v1.w + vec2(1)) * 0.5 * img_size;
+    vec2 p2 = (tri.v2.xy / tri.v2.w + vec2(1)) * 0.5 * img_size;
+    vec2 lo = min(p0, min(p1, p2)) - vec2(1);
+    vec2 hi = max(p0, max(p1, p2)) + vec2(1);
+    return all(lessThanEqual(lo, tile_max)) && all(greaterThanEqual(hi, tile_min));
+}
+
+void drawTri(TransformedTri tri, dvec2 point) {
+    vec4 os_v0 = vec4(tri.os_v0, 1);
+    vec4 os_v1 = vec4(tri.os_v1, 1);
+    vec4 os_v2 = vec4(tri.os_v2, 1);
+    vec4 v0 = tri.v0;
+    vec4 v1 = tri.v1;
+    vec4 v2 = tri.v2;
     dvec2 ss_v0 = dvec2(v0.xy) / v0.w;
     dvec2 ss_v1 = dvec2(v1.xy) / v1.w;
     dvec2 ss_v2 = dvec2(v2.xy) / v2.w;
@@ -120,16 +157,54 @@ void drawTri(Tri tri, mat4 matrix, dvec2 point) {
 
 void main() {
     ivec2 img_size = imageSize(renderTarget);
-    if (gl_GlobalInvocationID.x >= img_size.x || gl_GlobalInvocationID.y >= img_size.y)
-        return;
+    // no early out, the whole workgroup takes part in staging
+    bool active = gl_GlobalInvocationID.x < img_size.x && gl_GlobalInvocationID.y < img_size.y;
 
     dvec2 point = dvec2(gl_GlobalInvocationID.xy) / vec2(img_size);
     point = point * 2.0 - dvec2(1.0);
 
-    for (int j = 0; j < push_constants.matrices_count; j++) {
-        mat4 matrix = push_constants.matrices_buffer.matrices[j];
-        for (int i = 0; i < push_constants.triangles_count; i++) {
-            drawTri(push_constants.triangles_buffer.triangles[i], matrix, point);
+    vec2 tile_min = vec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy);
+    vec2 tile_max = tile_min + vec2(gl_WorkGroupSize.xy) - vec2(1);
+
+    uint total = push_constants.matrices_count * push_constants.triangles_count;
+    for (uint batch = 0; batch < total; batch += BATCH_SIZE) {
+        if (gl_LocalInvocationIndex == 0)
+            staged_count = 0;
+        barrier();
+
+        // one instance triangle per invocation, survivors are packed with a ballot and one shared atomic per subgroup
+        uint t = batch + gl_LocalInvocationIndex;
+        if (gl_LocalInvocationIndex < BATCH_SIZE && t < total) {
+            mat4 matrix = push_constants.matrices_buffer.matrices[t / push_constants.triangles_count];
+            TransformedTri tri = transformTri(push_constants.triangles_buffer.triangles[t % push_constants.triangles_count], matrix);
+            bool overlaps = overlapsTile(tri, tile_min, tile_max, vec2(img_size));
+#ifdef NO_SUBGROUP_BALLOT
+            staged_overlaps[gl_LocalInvocationIndex] = overlaps;
+            if (overlaps)
+                staged[gl_LocalInvocationIndex] = tri;
+            atomicMax(staged_count, gl_LocalInvocationIndex + 1);
+#else
+            uvec4 ballot = subgroupBallot(overlaps);
+            uint base = 0;
+            if (subgroupElect())
+                base = atomicAdd(staged_count, subgroupBallotBitCount(ballot));
+            base = subgroupBroadcastFirst(base);
+            if (overlaps)
+                staged[base + subgroupBallotExclusiveBitCount(ballot)] = tri;
+#endif
         }
+        barrier();
+
+        if (active) {
+            for (uint i = 0; i < staged_count; i++) {
+#ifdef NO_SUBGROUP_BALLOT
+                if (!staged_overlaps[i])
+                    continue;
+#endif
+                drawTri(staged[i], point);
+            }
+        }
+        // the next batch overwrites the staging area
+        barrier();
     }
-}
\ No newline at end of file
+}
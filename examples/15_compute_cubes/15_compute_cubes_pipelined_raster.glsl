@@ -2,6 +2,17 @@
 #extension GL_EXT_shader_image_load_formatted : require
 #extension GL_EXT_scalar_block_layout : require
 #extension GL_EXT_buffer_reference : require
+#ifndef NO_INT64
+#extension GL_EXT_shader_explicit_arithmetic_types_int64 : require
+#endif
+#ifndef NO_SUBGROUP_BALLOT
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_ballot : require
+#endif
+#ifdef COMPACT_TRIANGLES
+#extension GL_EXT_shader_16bit_storage : require
+#extension GL_EXT_shader_8bit_storage : require
+#endif
 
 layout(set = 0, binding = 0)
 uniform image2D renderTarget;
@@ -11,6 +22,9 @@ uniform image2D depthBuffer;
 
 layout(local_size_x = 32, local_size_y = 32, local_size_z = 1) in;
 
+// each invocation owns this many horizontally adjacent pixels, and steps the edge equations across them
+#define RUN_LENGTH 4
+
 struct Tri { vec3 v0, v1, v2; vec3 color; };
 
 struct PreprocessedTri {
@@ -21,15 +35,76 @@ struct PreprocessedTri {
     vec2 ss_v1;
     vec2 ss_v2;
     vec3 color;
+    ivec3 edge_a;
+    ivec3 edge_b;
+#ifdef NO_INT64
+    uint edge_c_unused[7];
+#else
+    i64vec3 edge_c;
+#endif
+    float inv_area;
+    ivec4 bbox;
+    uint flags;
 };
 
+const uint TRI_FIXED_POINT = 1;
+const uint TRI_CULLED = 2;
+const uint TRI_UNCOMPRESSED = 4;
+
 layout(scalar, buffer_reference) buffer PreprocessedTrianglesBuffer {
     PreprocessedTri triangles[192];
 };
 
+#ifdef COMPACT_TRIANGLES
+// see 15_compute_cubes_pipelined_triangles.glsl
+struct CompactTri {
+    i16vec2 position_hi[3];
+    u8vec2 position_lo[3];
+    float16_t inv_w[3];
+    uint color;
+};
+
+layout(scalar, buffer_reference) buffer CompactTrianglesBuffer {
+    CompactTri triangles[192];
+};
+
+// compact triangles only carry their vertices, the edge equations are set up while staging, once per workgroup
+struct StagedTri {
+    i64vec3 edge_a;
+    i64vec3 edge_b;
+    i64vec3 edge_c;
+    float inv_area;
+    ivec4 bbox;
+    vec3 inv_w;
+    vec3 color;
+    uint flags;
+    // where to find the full-size copy of TRI_UNCOMPRESSED triangles
+    uint index;
+};
+
+const int SUBPIXEL_BITS = 8;
+#else
+#define StagedTri PreprocessedTri
+#endif
+
+// triangles are brought in this many at a time, and only the ones touching the workgroup's tile are kept
+#define BATCH_SIZE 64
+shared StagedTri staged[BATCH_SIZE];
+shared uint staged_count;
+#ifdef NO_SUBGROUP_BALLOT
+// without ballots the batch isn't compacted, triangles keep their slot and the rejected ones are skipped
+shared bool staged_overlaps[BATCH_SIZE];
+#endif
+
 layout(scalar, push_constant) uniform T {
+#ifdef COMPACT_TRIANGLES
+    CompactTrianglesBuffer preprocessed_triangles_buffer;
+#else
     PreprocessedTrianglesBuffer preprocessed_triangles_buffer;
+#endif
     uint triangles_count;
+    // only read by the compact variant, for the triangles it couldn't encode
+    PreprocessedTrianglesBuffer uncompressed_triangles_buffer;
 } push_constants;
 
 float cross_2(vec2 a, vec2 b) {
@@ -60,7 +135,19 @@ bool is_inside_edge(vec2 e0, vec2 e1, vec2 p) {
     return (ey < p.y) ^^ (e0.x > e1.x);
 }
 
-void drawTri(PreprocessedTri tri, vec2 point) {
+#ifdef COMPACT_TRIANGLES
+// the same depth as the fixed-point path, see fixedPointDepth()
+float floatDepth(PreprocessedTri tri, vec3 ss_v_coefs) {
+    return 1.0 / (1.0 + dot(ss_v_coefs, vec3(1.0 / tri.v0.w, 1.0 / tri.v1.w, 1.0 / tri.v2.w)));
+}
+#else
+float floatDepth(PreprocessedTri tri, vec3 ss_v_coefs) {
+    return dot(ss_v_coefs, vec3(tri.v0.z / tri.v0.w, tri.v1.z / tri.v1.w, tri.v2.z / tri.v2.w));
+}
+#endif
+
+// for triangles without edge equations, returns a negative depth outside of the triangle
+float floatTriDepth(PreprocessedTri tri, vec2 point) {
     vec4 v0 = tri.v0;
     vec4 v1 = tri.v1;
     vec4 v2 = tri.v2;
@@ -68,52 +155,203 @@ void drawTri(PreprocessedTri tri, vec2 point) {
     vec2 ss_v1 = tri.ss_v1;
     vec2 ss_v2 = tri.ss_v2;
 
-    vec4 pixelColor = vec4(tri.color, 1);
-
     bool backface = ((is_inside_edge(ss_v1.xy, ss_v0.xy, point) ^^ (v0.w < 0) ^^ (v1.w < 0)) && (is_inside_edge(ss_v2.xy, ss_v1.xy, point) ^^ (v1.w < 0) ^^ (v2.w < 0)) && (is_inside_edge(ss_v0.xy, ss_v2.xy, point) ^^ (v2.w < 0) ^^ (v0.w < 0)));
     bool frontface = (is_inside_edge(ss_v0.xy, ss_v1.xy, point) ^^ (v0.w < 0) ^^ (v1.w < 0)) && (is_inside_edge(ss_v1.xy, ss_v2.xy, point) ^^ (v1.w < 0) ^^ (v2.w < 0)) && (is_inside_edge(ss_v2.xy, ss_v0.xy, point) ^^ (v2.w < 0) ^^ (v0.w < 0));
     if (!frontface && !backface)
-        return;
+        return -1;
 
     vec3 baryResults = barycentricTri2(ss_v0.xy, ss_v1.xy, ss_v2.xy, point);
     float u = baryResults.x;
     float v = baryResults.y;
     float w = 1 - u - v;
 
-    vec3 v_ws = vec3(v0.w, v1.w, v2.w);
     vec3 ss_v_coefs = vec3(v, w, u);
-    vec3 pc_v_coefs = ss_v_coefs / v_ws;
-    float pc_v_coefs_sum = pc_v_coefs.x + pc_v_coefs.y + pc_v_coefs.z;
-    pc_v_coefs = pc_v_coefs / pc_v_coefs_sum;
+    return floatDepth(tri, ss_v_coefs);
+}
+
+#ifdef COMPACT_TRIANGLES
+// same setup as the full-size triangles get in 15_compute_cubes_pipelined_triangles.glsl, but with 8 fractional bits and 64-bit coefficients
+// the 16- and 8-bit fields are converted as they're read, they can't be held in locals
+StagedTri loadTri(uint t, ivec2 img_size) {
+    CompactTrianglesBuffer compact = push_constants.preprocessed_triangles_buffer;
+    uint color = compact.triangles[t].color;
+    StagedTri tri;
+    tri.color = unpackUnorm4x8(color).rgb;
+    tri.flags = color >> 24;
+    tri.index = t;
+    tri.edge_a = i64vec3(0);
+    tri.edge_b = i64vec3(0);
+    tri.edge_c = i64vec3(0);
+    tri.inv_area = 0;
+    tri.bbox = ivec4(0);
+    tri.inv_w = vec3(0);
+    if ((tri.flags & TRI_UNCOMPRESSED) != 0)
+        return tri;
+
+    tri.flags |= TRI_FIXED_POINT;
+    ivec2 p[3];
+    for (int i = 0; i < 3; i++) {
+        p[i] = (ivec2(compact.triangles[t].position_hi[i]) << 8) | ivec2(compact.triangles[t].position_lo[i]);
+        tri.inv_w[i] = float(compact.triangles[t].inv_w[i]);
+    }
 
-    float depth = float(dot(ss_v_coefs, vec3(v0.z / v0.w, v1.z / v1.w, v2.z / v2.w)));
+    int64_t area2 = int64_t(p[1].x - p[0].x) * (p[2].y - p[0].y) - int64_t(p[1].y - p[0].y) * (p[2].x - p[0].x);
+    if (area2 == 0) {
+        tri.flags |= TRI_CULLED;
+        return tri;
+    }
+    for (int i = 0; i < 3; i++) {
+        ivec2 a = p[(i + 1) % 3];
+        ivec2 b = p[(i + 2) % 3];
+        tri.edge_a[i] = int64_t(-(b.y - a.y)) << SUBPIXEL_BITS;
+        tri.edge_b[i] = int64_t(b.x - a.x) << SUBPIXEL_BITS;
+        tri.edge_c[i] = int64_t(b.y - a.y) * a.x - int64_t(b.x - a.x) * a.y;
+    }
+    if (area2 < 0) {
+        tri.edge_a = -tri.edge_a;
+        tri.edge_b = -tri.edge_b;
+        tri.edge_c = -tri.edge_c;
+        area2 = -area2;
+    }
+    tri.inv_area = 1.0 / float(area2);
+    for (int i = 0; i < 3; i++) {
+        bool top_left = tri.edge_a[i] > 0 || (tri.edge_a[i] == 0 && tri.edge_b[i] > 0);
+        if (!top_left)
+            tri.edge_c[i] -= int64_t(1);
+    }
 
-    if (depth < 0)
-        return;
+    ivec2 lo = min(p[0], min(p[1], p[2]));
+    ivec2 hi = max(p[0], max(p[1], p[2]));
+    const int subpixel_mask = (1 << SUBPIXEL_BITS) - 1;
+    ivec2 first = max((lo + ivec2(subpixel_mask)) >> SUBPIXEL_BITS, ivec2(0));
+    ivec2 last = min(hi >> SUBPIXEL_BITS, img_size - ivec2(1));
+    tri.bbox = ivec4(first, last);
+    if (first.x > last.x || first.y > last.y)
+        tri.flags |= TRI_CULLED;
+    return tri;
+}
 
-    float prevDepth = imageLoad(depthBuffer, ivec2(gl_GlobalInvocationID.xy)).x;
-    if (depth < prevDepth)
-        imageStore(depthBuffer, ivec2(gl_GlobalInvocationID.xy), vec4(depth));
-    else
-        return;
+// 1/w interpolates linearly in screen space like z/w does, and grows towards the camera
+float fixedPointDepth(StagedTri tri, vec3 bary) {
+    return 1.0 / (1.0 + dot(bary, tri.inv_w));
+}
+#else
+StagedTri loadTri(uint t, ivec2 img_size) {
+    return push_constants.preprocessed_triangles_buffer.triangles[t];
+}
 
-    //pixelColor = vec4(prevDepth);
-    //pixelColor.r = 1;
+float fixedPointDepth(StagedTri tri, vec3 bary) {
+    return dot(bary, vec3(tri.v0.z / tri.v0.w, tri.v1.z / tri.v1.w, tri.v2.z / tri.v2.w));
+}
+#endif
 
-    //vec4 previousPixelColor = imageLoad(renderTarget, ivec2(gl_GlobalInvocationID.xy));
-    //pixelColor.rgb = mix(pixelColor.rgb, previousPixelColor.rgb, 0.5);
-    imageStore(renderTarget, ivec2(gl_GlobalInvocationID.xy), pixelColor);
+bool overlapsTile(StagedTri tri, ivec2 tile_min, ivec2 tile_max) {
+    if ((tri.flags & TRI_CULLED) != 0)
+        return false;
+    // without edge equations there are no bounds either
+    if ((tri.flags & TRI_FIXED_POINT) == 0)
+        return true;
+    return tri.bbox.x <= tile_max.x && tri.bbox.z >= tile_min.x && tri.bbox.y <= tile_max.y && tri.bbox.w >= tile_min.y;
 }
 
 void main() {
     ivec2 img_size = imageSize(renderTarget);
-    if (gl_GlobalInvocationID.x >= img_size.x || gl_GlobalInvocationID.y >= img_size.y)
-        return;
+    ivec2 run = ivec2(gl_GlobalInvocationID.x * RUN_LENGTH, gl_GlobalInvocationID.y);
+    // no early out, the whole workgroup takes part in staging
+    bool active = run.x < img_size.x && run.y < img_size.y;
+    int run_length = active ? min(RUN_LENGTH, img_size.x - run.x) : 0;
 
-    vec2 point = vec2(gl_GlobalInvocationID.xy) / vec2(img_size);
-    point = point * 2.0 - vec2(1.0);
+    ivec2 tile_min = ivec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) * ivec2(RUN_LENGTH, 1);
+    ivec2 tile_max = min(tile_min + ivec2(gl_WorkGroupSize.xy) * ivec2(RUN_LENGTH, 1), img_size) - ivec2(1);
 
-    for (int i = 0; i < push_constants.triangles_count; i++) {
-        drawTri(push_constants.preprocessed_triangles_buffer.triangles[i], point);
+    // the pixels are ours alone, so depth and colour stay in registers until all triangles are done
+    float depths[RUN_LENGTH];
+    vec3 colors[RUN_LENGTH];
+    bool written[RUN_LENGTH];
+    for (int i = 0; i < run_length; i++) {
+        depths[i] = imageLoad(depthBuffer, run + ivec2(i, 0)).x;
+        written[i] = false;
     }
-}
\ No newline at end of file
+
+    for (uint batch = 0; batch < push_constants.triangles_count; batch += BATCH_SIZE) {
+        if (gl_LocalInvocationIndex == 0)
+            staged_count = 0;
+        barrier();
+
+        // one triangle per invocation, survivors are packed with a ballot and one shared atomic per subgroup
+        uint t = batch + gl_LocalInvocationIndex;
+        if (gl_LocalInvocationIndex < BATCH_SIZE && t < push_constants.triangles_count) {
+            StagedTri tri = loadTri(t, img_size);
+            bool overlaps = overlapsTile(tri, tile_min, tile_max);
+#ifdef NO_SUBGROUP_BALLOT
+            staged_overlaps[gl_LocalInvocationIndex] = overlaps;
+            if (overlaps)
+                staged[gl_LocalInvocationIndex] = tri;
+            atomicMax(staged_count, gl_LocalInvocationIndex + 1);
+#else
+            uvec4 ballot = subgroupBallot(overlaps);
+            uint base = 0;
+            if (subgroupElect())
+                base = atomicAdd(staged_count, subgroupBallotBitCount(ballot));
+            base = subgroupBroadcastFirst(base);
+            if (overlaps)
+                staged[base + subgroupBallotExclusiveBitCount(ballot)] = tri;
+#endif
+        }
+        barrier();
+
+        for (uint s = 0; s < staged_count; s++) {
+#ifdef NO_SUBGROUP_BALLOT
+            if (!staged_overlaps[s])
+                continue;
+#endif
+            StagedTri tri = staged[s];
+
+#ifndef NO_INT64
+            if ((tri.flags & TRI_FIXED_POINT) != 0) {
+                if (run.y < tri.bbox.y || run.y > tri.bbox.w || run.x + run_length - 1 < tri.bbox.x || run.x > tri.bbox.z)
+                    continue;
+
+                i64vec3 e = i64vec3(tri.edge_a) * int64_t(run.x) + i64vec3(tri.edge_b) * int64_t(run.y) + tri.edge_c;
+                for (int i = 0; i < run_length; i++) {
+                    if (all(greaterThanEqual(e, i64vec3(0)))) {
+                        float depth = fixedPointDepth(tri, vec3(e) * tri.inv_area);
+                        if (depth >= 0 && depth < depths[i]) {
+                            depths[i] = depth;
+                            colors[i] = tri.color;
+                            written[i] = true;
+                        }
+                    }
+                    e += i64vec3(tri.edge_a);
+                }
+                continue;
+            }
+#endif
+#ifdef COMPACT_TRIANGLES
+            // the compact encoding couldn't hold it, the full-size copy takes the floating-point path
+            PreprocessedTri full = push_constants.uncompressed_triangles_buffer.triangles[tri.index];
+#else
+            PreprocessedTri full = tri;
+#endif
+            for (int i = 0; i < run_length; i++) {
+                vec2 point = vec2(run + ivec2(i, 0)) / vec2(img_size);
+                point = point * 2.0 - vec2(1.0);
+                float depth = floatTriDepth(full, point);
+                if (depth >= 0 && depth < depths[i]) {
+                    depths[i] = depth;
+                    colors[i] = full.color;
+                    written[i] = true;
+                }
+            }
+        }
+        // the next batch overwrites the staging area
+        barrier();
+    }
+
+    for (int i = 0; i < run_length; i++) {
+        if (!written[i])
+            continue;
+        imageStore(depthBuffer, run + ivec2(i, 0), vec4(depths[i]));
+        imageStore(renderTarget, run + ivec2(i, 0), vec4(colors[i], 1));
+    }
+}
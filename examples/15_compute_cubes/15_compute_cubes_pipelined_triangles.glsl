@@ -2,6 +2,13 @@
 #extension GL_EXT_shader_image_load_formatted : require
 #extension GL_EXT_scalar_block_layout : require
 #extension GL_EXT_buffer_reference : require
+#ifndef NO_INT64
+#extension GL_EXT_shader_explicit_arithmetic_types_int64 : require
+#endif
+#ifdef COMPACT_TRIANGLES
+#extension GL_EXT_shader_16bit_storage : require
+#extension GL_EXT_shader_8bit_storage : require
+#endif
 
 layout(local_size_x = 32, local_size_y = 32, local_size_z = 1) in;
 
@@ -23,21 +30,149 @@ struct PreprocessedTri {
     vec2 ss_v1;
     vec2 ss_v2;
     vec3 color;
+    // fixed-point edge equations E(x, y) = edge_a * x + edge_b * y + edge_c at integer pixel positions, one per vertex, for the edge facing it.
+    // They're all >= 0 inside the triangle, fill rule included, and E * inv_area are the barycentrics.
+    ivec3 edge_a;
+    ivec3 edge_b;
+#ifdef NO_INT64
+    // keeps the layout of the 64-bit variant
+    uint edge_c_unused[7];
+#else
+    i64vec3 edge_c;
+#endif
+    float inv_area;
+    // covered pixels, inclusive and clamped to the viewport
+    ivec4 bbox;
+    uint flags;
 };
 
+// the edge equations are set up, otherwise the rasterizer falls back to the floating-point tests
+const uint TRI_FIXED_POINT = 1;
+// covers no pixel
+const uint TRI_CULLED = 2;
+// compact mode only: couldn't be encoded, the rasterizer reads the full-size copy instead
+const uint TRI_UNCOMPRESSED = 4;
+
+const int SUBPIXEL_BITS = 4;
+// keeps the vertex positions within 23 bits so the edge coefficients fit 32 bits
+const float GUARD_BAND = float(1 << 22);
+
 layout(scalar, buffer_reference) buffer PreprocessedTrianglesBuffer {
     PreprocessedTri triangles[192];
 };
 
+#ifdef COMPACT_TRIANGLES
+// 28 bytes: screen positions in 16.8 fixed point, 1/w in fp16 and an RGBA8 colour whose alpha holds the flags.
+// Triangles crossing the camera plane, reaching beyond +-32768 pixels or with a 1/w too large for fp16 can't be encoded, they're written full-size to `uncompressed_buffer` as well.
+// The 16- and 8-bit types may only live in buffer memory, so the fields are written one by one rather than through a local CompactTri.
+struct CompactTri {
+    i16vec2 position_hi[3];
+    u8vec2 position_lo[3];
+    float16_t inv_w[3];
+    uint color;
+};
+
+layout(scalar, buffer_reference) buffer CompactTrianglesBuffer {
+    CompactTri triangles[192];
+};
+#endif
+
 layout(scalar, push_constant) uniform T {
 	TrianglesBuffer triangles_buffer;
     uint triangles_count;
     MatricesBuffer matrices_buffer;
     uint matrices_count;
+#ifdef COMPACT_TRIANGLES
+    CompactTrianglesBuffer output_buffer;
+#else
     PreprocessedTrianglesBuffer output_buffer;
+#endif
 	float time;
+    uvec2 viewport;
+    // of the 8 fractional bits of the compact positions, how many are kept
+    uint subpixel_bits;
+    // only written by the compact variant
+    PreprocessedTrianglesBuffer uncompressed_buffer;
 } push_constants;
 
+#ifdef NO_INT64
+// without 64-bit integers, every triangle takes the rasterizer's floating-point path
+void setupFixedPoint(inout PreprocessedTri tri) {
+    tri.edge_a = ivec3(0);
+    tri.edge_b = ivec3(0);
+    tri.inv_area = 0;
+    tri.bbox = ivec4(0);
+    tri.flags = 0;
+}
+#else
+// a -> b, looking from the vertex opposite to it
+void setupEdge(ivec2 a, ivec2 b, out int edge_a, out int edge_b, out int64_t edge_c) {
+    edge_a = -(b.y - a.y) << SUBPIXEL_BITS;
+    edge_b = (b.x - a.x) << SUBPIXEL_BITS;
+    edge_c = int64_t(b.y - a.y) * a.x - int64_t(b.x - a.x) * a.y;
+}
+
+void setupFixedPoint(inout PreprocessedTri tri) {
+    tri.edge_a = ivec3(0);
+    tri.edge_b = ivec3(0);
+    tri.edge_c = i64vec3(0);
+    tri.inv_area = 0;
+    tri.bbox = ivec4(0);
+    tri.flags = 0;
+
+    // triangles crossing the camera plane don't project to a triangle
+    if (tri.v0.w <= 0 || tri.v1.w <= 0 || tri.v2.w <= 0)
+        return;
+
+    vec2 scale = vec2(push_constants.viewport) * 0.5 * float(1 << SUBPIXEL_BITS);
+    vec2 f0 = (tri.ss_v0 + vec2(1)) * scale;
+    vec2 f1 = (tri.ss_v1 + vec2(1)) * scale;
+    vec2 f2 = (tri.ss_v2 + vec2(1)) * scale;
+    vec2 extent = max(abs(f0), max(abs(f1), abs(f2)));
+    if (extent.x >= GUARD_BAND || extent.y >= GUARD_BAND)
+        return;
+
+    ivec2 p0 = ivec2(round(f0));
+    ivec2 p1 = ivec2(round(f1));
+    ivec2 p2 = ivec2(round(f2));
+
+    tri.flags = TRI_FIXED_POINT;
+    int64_t area2 = int64_t(p1.x - p0.x) * (p2.y - p0.y) - int64_t(p1.y - p0.y) * (p2.x - p0.x);
+    if (area2 == 0) {
+        tri.flags |= TRI_CULLED;
+        return;
+    }
+
+    setupEdge(p1, p2, tri.edge_a.x, tri.edge_b.x, tri.edge_c.x);
+    setupEdge(p2, p0, tri.edge_a.y, tri.edge_b.y, tri.edge_c.y);
+    setupEdge(p0, p1, tri.edge_a.z, tri.edge_b.z, tri.edge_c.z);
+    // both windings are drawn, flip the back faces so inside is always positive
+    if (area2 < 0) {
+        tri.edge_a = -tri.edge_a;
+        tri.edge_b = -tri.edge_b;
+        tri.edge_c = -tri.edge_c;
+        area2 = -area2;
+    }
+    tri.inv_area = 1.0 / float(area2);
+
+    // top-left rule: pixels exactly on an edge belong to the triangle on its right or below it, the -1 makes E >= 0 fail for the others
+    for (int i = 0; i < 3; i++) {
+        bool top_left = tri.edge_a[i] > 0 || (tri.edge_a[i] == 0 && tri.edge_b[i] > 0);
+        if (!top_left)
+            tri.edge_c[i] -= int64_t(1);
+    }
+
+    ivec2 lo = min(p0, min(p1, p2));
+    ivec2 hi = max(p0, max(p1, p2));
+    const int subpixel_mask = (1 << SUBPIXEL_BITS) - 1;
+    ivec2 first = max((lo + ivec2(subpixel_mask)) >> SUBPIXEL_BITS, ivec2(0));
+    ivec2 last = min(hi >> SUBPIXEL_BITS, ivec2(push_constants.viewport) - ivec2(1));
+    tri.bbox = ivec4(first, last);
+    if (first.x > last.x || first.y > last.y)
+        tri.flags |= TRI_CULLED;
+}
+#endif
+
 PreprocessedTri processTri(Tri tri, mat4 matrix) {
     vec4 v0 = matrix * vec4(tri.v0, 1);
     vec4 v1 = matrix * vec4(tri.v1, 1);
@@ -48,8 +183,46 @@ PreprocessedTri processTri(Tri tri, mat4 matrix) {
 
     vec4 pixelColor = vec4(tri.color, 1);
 
-    return PreprocessedTri(v0, v1, v2, ss_v0, ss_v1, ss_v2, tri.color);
+    PreprocessedTri preprocessed;
+    preprocessed.v0 = v0;
+    preprocessed.v1 = v1;
+    preprocessed.v2 = v2;
+    preprocessed.ss_v0 = ss_v0;
+    preprocessed.ss_v1 = ss_v1;
+    preprocessed.ss_v2 = ss_v2;
+    preprocessed.color = tri.color;
+    setupFixedPoint(preprocessed);
+    return preprocessed;
+}
+
+#ifdef COMPACT_TRIANGLES
+void writeCompactTri(uint tri_id, PreprocessedTri tri) {
+    uint flags = 0;
+    vec4 v[3] = vec4[3](tri.v0, tri.v1, tri.v2);
+    vec2 ss[3] = vec2[3](tri.ss_v0, tri.ss_v1, tri.ss_v2);
+    for (int i = 0; i < 3; i++) {
+        vec2 pixels = (ss[i] + vec2(1)) * 0.5 * vec2(push_constants.viewport);
+        // checked in float first, so the conversion below can't overflow, and 1/w past the largest fp16 would become inf
+        if (v[i].w <= 0 || 1.0 / v[i].w > 65504.0 || any(greaterThanEqual(abs(pixels), vec2(32768)))) {
+            flags = TRI_UNCOMPRESSED;
+            continue;
+        }
+        // rounded to the configured precision, but always stored with 8 fractional bits
+        ivec2 fixed_point = ivec2(round(pixels * float(1 << push_constants.subpixel_bits))) << (8 - push_constants.subpixel_bits);
+        // rounding can still carry past what the 16 integer bits hold
+        if (any(greaterThan(fixed_point, ivec2((1 << 23) - 1))) || any(lessThan(fixed_point, ivec2(-(1 << 23))))) {
+            flags = TRI_UNCOMPRESSED;
+            continue;
+        }
+        push_constants.output_buffer.triangles[tri_id].position_hi[i] = i16vec2(fixed_point >> 8);
+        push_constants.output_buffer.triangles[tri_id].position_lo[i] = u8vec2(fixed_point & 0xFF);
+        push_constants.output_buffer.triangles[tri_id].inv_w[i] = float16_t(1.0 / v[i].w);
+    }
+    push_constants.output_buffer.triangles[tri_id].color = (packUnorm4x8(vec4(tri.color, 0)) & 0x00FFFFFFu) | (flags << 24);
+    if (flags == TRI_UNCOMPRESSED)
+        push_constants.uncompressed_buffer.triangles[tri_id] = tri;
 }
+#endif
 
 void main() {
     if (gl_GlobalInvocationID.x >= push_constants.triangles_count
@@ -59,5 +232,9 @@ void main() {
     uint tri_id = gl_GlobalInvocationID.y * push_constants.triangles_count + gl_GlobalInvocationID.x;
 
     mat4 matrix = push_constants.matrices_buffer.matrices[gl_GlobalInvocationID.y];
+#ifdef COMPACT_TRIANGLES
+    writeCompactTri(tri_id, processTri(push_constants.triangles_buffer.triangles[gl_GlobalInvocationID.x], matrix));
+#else
     push_constants.output_buffer.triangles[tri_id] = processTri(push_constants.triangles_buffer.triangles[gl_GlobalInvocationID.x], matrix);
+#endif
 }
\ No newline at end of file
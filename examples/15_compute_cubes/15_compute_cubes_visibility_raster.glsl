@@ -0,0 +1,137 @@
+#version 450
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_shader_explicit_arithmetic_types_int64 : require
+#extension GL_EXT_shader_atomic_int64 : require
+
+// only depth and triangle IDs are written here, the resolve pass shades the winners
+// one layer of workgroups per triangle, the layers race for the same pixels and the atomicMin settles it
+layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+
+// each invocation covers this many horizontally adjacent pixels, and steps the edge equations across them
+#define RUN_LENGTH 4
+
+struct PreprocessedTri {
+    vec4 v0;
+    vec4 v1;
+    vec4 v2;
+    vec2 ss_v0;
+    vec2 ss_v1;
+    vec2 ss_v2;
+    vec3 color;
+    ivec3 edge_a;
+    ivec3 edge_b;
+    i64vec3 edge_c;
+    float inv_area;
+    ivec4 bbox;
+    uint flags;
+};
+
+const uint TRI_FIXED_POINT = 1;
+const uint TRI_CULLED = 2;
+
+layout(scalar, buffer_reference) buffer PreprocessedTrianglesBuffer {
+    PreprocessedTri triangles[192];
+};
+
+// depth in the high half and the triangle in the low half, so the smallest value is the closest triangle
+layout(scalar, buffer_reference) buffer VisibilityBuffer {
+    uint64_t texels[];
+};
+
+layout(scalar, push_constant) uniform T {
+    PreprocessedTrianglesBuffer preprocessed_triangles_buffer;
+    uint triangles_count;
+    VisibilityBuffer visibility_buffer;
+    uvec2 size;
+} push_constants;
+
+float cross_2(vec2 a, vec2 b) {
+    return cross(vec3(a, 0), vec3(b, 0)).z;
+}
+
+float barCoord(vec2 a, vec2 b, vec2 point){
+    vec2 PA = point - a;
+    vec2 BA = b - a;
+    return cross_2(PA, BA);
+}
+
+vec3 barycentricTri2(vec2 v0, vec2 v1, vec2 v2, vec2 point) {
+    float triangleArea = barCoord(v0.xy, v1.xy, v2.xy);
+
+    float u = barCoord(v0.xy, v1.xy, point) / triangleArea;
+    float v = barCoord(v1.xy, v2.xy, point) / triangleArea;
+
+    return vec3(u, v, triangleArea);
+}
+
+bool is_inside_edge(vec2 e0, vec2 e1, vec2 p) {
+    if (e1.x == e0.x)
+    return (e1.x > p.x) ^^ (e0.y > e1.y);
+    float a = (e1.y - e0.y) / (e1.x - e0.x);
+    float b = e0.y + (0 - e0.x) * a;
+    float ey = a * p.x + b;
+    return (ey < p.y) ^^ (e0.x > e1.x);
+}
+
+// for triangles without edge equations, returns a negative depth outside of the triangle
+float floatTriDepth(PreprocessedTri tri, vec2 point) {
+    vec4 v0 = tri.v0;
+    vec4 v1 = tri.v1;
+    vec4 v2 = tri.v2;
+    vec2 ss_v0 = tri.ss_v0;
+    vec2 ss_v1 = tri.ss_v1;
+    vec2 ss_v2 = tri.ss_v2;
+
+    bool backface = ((is_inside_edge(ss_v1.xy, ss_v0.xy, point) ^^ (v0.w < 0) ^^ (v1.w < 0)) && (is_inside_edge(ss_v2.xy, ss_v1.xy, point) ^^ (v1.w < 0) ^^ (v2.w < 0)) && (is_inside_edge(ss_v0.xy, ss_v2.xy, point) ^^ (v2.w < 0) ^^ (v0.w < 0)));
+    bool frontface = (is_inside_edge(ss_v0.xy, ss_v1.xy, point) ^^ (v0.w < 0) ^^ (v1.w < 0)) && (is_inside_edge(ss_v1.xy, ss_v2.xy, point) ^^ (v1.w < 0) ^^ (v2.w < 0)) && (is_inside_edge(ss_v2.xy, ss_v0.xy, point) ^^ (v2.w < 0) ^^ (v0.w < 0));
+    if (!frontface && !backface)
+        return -1;
+
+    vec3 baryResults = barycentricTri2(ss_v0.xy, ss_v1.xy, ss_v2.xy, point);
+    float u = baryResults.x;
+    float v = baryResults.y;
+    float w = 1 - u - v;
+
+    vec3 ss_v_coefs = vec3(v, w, u);
+    return float(dot(ss_v_coefs, vec3(v0.z / v0.w, v1.z / v1.w, v2.z / v2.w)));
+}
+
+void writeFragment(ivec2 pixel, float depth, uint tri_id) {
+    // positive floats sort like their bits
+    if (depth < 0 || depth >= 1)
+        return;
+
+    uint64_t packed = (uint64_t(floatBitsToUint(depth)) << 32) | uint64_t(tri_id);
+    atomicMin(push_constants.visibility_buffer.texels[pixel.y * push_constants.size.x + pixel.x], packed);
+}
+
+void main() {
+    ivec2 run = ivec2(gl_GlobalInvocationID.x * RUN_LENGTH, gl_GlobalInvocationID.y);
+    if (run.x >= push_constants.size.x || run.y >= push_constants.size.y || gl_GlobalInvocationID.z >= push_constants.triangles_count)
+        return;
+    int run_length = min(RUN_LENGTH, int(push_constants.size.x) - run.x);
+
+    uint tri_id = gl_GlobalInvocationID.z;
+    PreprocessedTri tri = push_constants.preprocessed_triangles_buffer.triangles[tri_id];
+
+    if ((tri.flags & TRI_FIXED_POINT) != 0) {
+        if ((tri.flags & TRI_CULLED) != 0 || run.y < tri.bbox.y || run.y > tri.bbox.w || run.x + run_length - 1 < tri.bbox.x || run.x > tri.bbox.z)
+            return;
+
+        vec3 z = vec3(tri.v0.z / tri.v0.w, tri.v1.z / tri.v1.w, tri.v2.z / tri.v2.w);
+        i64vec3 e = i64vec3(tri.edge_a) * int64_t(run.x) + i64vec3(tri.edge_b) * int64_t(run.y) + tri.edge_c;
+        for (int i = 0; i < run_length; i++) {
+            if (all(greaterThanEqual(e, i64vec3(0))))
+                writeFragment(run + ivec2(i, 0), dot(vec3(e) * tri.inv_area, z), tri_id);
+            e += i64vec3(tri.edge_a);
+        }
+        return;
+    }
+
+    for (int i = 0; i < run_length; i++) {
+        vec2 point = vec2(run + ivec2(i, 0)) / vec2(push_constants.size);
+        point = point * 2.0 - vec2(1.0);
+        writeFragment(run + ivec2(i, 0), floatTriDepth(tri, point), tri_id);
+    }
+}
@@ -0,0 +1,108 @@
+#version 450
+#extension GL_EXT_shader_image_load_formatted : require
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_shader_explicit_arithmetic_types_int64 : require
+
+layout(set = 0, binding = 0)
+uniform image2D renderTarget;
+
+layout(set = 0, binding = 1)
+uniform image2D depthBuffer;
+
+layout(local_size_x = 32, local_size_y = 32, local_size_z = 1) in;
+
+struct PreprocessedTri {
+    vec4 v0;
+    vec4 v1;
+    vec4 v2;
+    vec2 ss_v0;
+    vec2 ss_v1;
+    vec2 ss_v2;
+    vec3 color;
+    ivec3 edge_a;
+    ivec3 edge_b;
+    i64vec3 edge_c;
+    float inv_area;
+    ivec4 bbox;
+    uint flags;
+};
+
+const uint TRI_FIXED_POINT = 1;
+
+layout(scalar, buffer_reference) buffer PreprocessedTrianglesBuffer {
+    PreprocessedTri triangles[192];
+};
+
+layout(scalar, buffer_reference) buffer VisibilityBuffer {
+    uint64_t texels[];
+};
+
+layout(scalar, push_constant) uniform T {
+    PreprocessedTrianglesBuffer preprocessed_triangles_buffer;
+    VisibilityBuffer visibility_buffer;
+} push_constants;
+
+float cross_2(vec2 a, vec2 b) {
+    return cross(vec3(a, 0), vec3(b, 0)).z;
+}
+
+float barCoord(vec2 a, vec2 b, vec2 point){
+    vec2 PA = point - a;
+    vec2 BA = b - a;
+    return cross_2(PA, BA);
+}
+
+vec3 barycentricTri2(vec2 v0, vec2 v1, vec2 v2, vec2 point) {
+    float triangleArea = barCoord(v0.xy, v1.xy, v2.xy);
+
+    float u = barCoord(v0.xy, v1.xy, point) / triangleArea;
+    float v = barCoord(v1.xy, v2.xy, point) / triangleArea;
+
+    return vec3(u, v, triangleArea);
+}
+
+// perspective-correct weights of the triangle's vertices at this pixel
+vec3 barycentrics(PreprocessedTri tri, ivec2 pixel, vec2 point) {
+    vec3 ss_v_coefs;
+    if ((tri.flags & TRI_FIXED_POINT) != 0) {
+        // the same screen-space barycentrics the rasterizer used
+        i64vec3 e = i64vec3(tri.edge_a) * int64_t(pixel.x) + i64vec3(tri.edge_b) * int64_t(pixel.y) + tri.edge_c;
+        ss_v_coefs = vec3(e) * tri.inv_area;
+    } else {
+        vec3 baryResults = barycentricTri2(tri.ss_v0, tri.ss_v1, tri.ss_v2, point);
+        float u = baryResults.x;
+        float v = baryResults.y;
+        float w = 1 - u - v;
+        ss_v_coefs = vec3(v, w, u);
+    }
+
+    vec3 pc_v_coefs = ss_v_coefs / vec3(tri.v0.w, tri.v1.w, tri.v2.w);
+    return pc_v_coefs / (pc_v_coefs.x + pc_v_coefs.y + pc_v_coefs.z);
+}
+
+// only runs once per pixel, whatever the overdraw was: flat colour like the other raster paths, and the depth they'd have written
+void shade(PreprocessedTri tri, ivec2 pixel, vec2 point) {
+    vec3 bary = barycentrics(tri, pixel, point);
+    vec4 position = bary.x * tri.v0 + bary.y * tri.v1 + bary.z * tri.v2;
+
+    imageStore(renderTarget, pixel, vec4(tri.color, 1));
+    imageStore(depthBuffer, pixel, vec4(position.z / position.w));
+}
+
+void main() {
+    ivec2 img_size = imageSize(renderTarget);
+    if (gl_GlobalInvocationID.x >= img_size.x || gl_GlobalInvocationID.y >= img_size.y)
+        return;
+
+    uint64_t packed = push_constants.visibility_buffer.texels[gl_GlobalInvocationID.y * img_size.x + gl_GlobalInvocationID.x];
+    // still cleared to all ones, nothing covers this pixel
+    if (uint(packed >> 32) == 0xFFFFFFFFu)
+        return;
+
+    vec2 point = vec2(gl_GlobalInvocationID.xy) / vec2(img_size);
+    point = point * 2.0 - vec2(1.0);
+
+    uint tri_id = uint(packed & 0xFFFFFFFFul);
+    shade(push_constants.preprocessed_triangles_buffer.triangles[tri_id], ivec2(gl_GlobalInvocationID.xy), point);
+}
@@ -0,0 +1,218 @@
+#include "imr/imr.h"
+#include "imr/util.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+
+// Checks the GPU primitives against a CPU reference and times both
+// usage: compute_primitives [element count] [iterations]
+
+static const VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+namespace reference {
+
+std::vector<uint32_t> exclusive_scan(const std::vector<uint32_t>& input) {
+    std::vector<uint32_t> output(input.size());
+    std::exclusive_scan(input.begin(), input.end(), output.begin(), 0u);
+    return output;
+}
+
+std::vector<uint32_t> compact(const std::vector<uint32_t>& input, const std::vector<uint32_t>& flags) {
+    std::vector<uint32_t> output;
+    for (size_t i = 0; i < input.size(); i++)
+        if (flags[i])
+            output.push_back(input[i]);
+    return output;
+}
+
+template<typename K>
+void radix_sort(std::vector<K>& keys, std::vector<uint32_t>& payloads) {
+    std::vector<size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+    std::vector<K> sorted_keys(keys.size());
+    std::vector<uint32_t> sorted_payloads(keys.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sorted_keys[i] = keys[order[i]];
+        sorted_payloads[i] = payloads[order[i]];
+    }
+    keys = std::move(sorted_keys);
+    payloads = std::move(sorted_payloads);
+}
+
+}
+
+struct Benchmark {
+    imr::Device& device;
+    imr::ComputePrimitives primitives;
+    VkQueryPool query_pool;
+    float timestamp_period;
+    int iterations;
+
+    Benchmark(imr::Device& device, int iterations) : device(device), primitives(device), iterations(iterations) {
+        vkCreateQueryPool(device.device, tmpPtr((VkQueryPoolCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = 2,
+        }), nullptr, &query_pool);
+        timestamp_period = device.physical_device.properties.limits.timestampPeriod;
+    }
+
+    ~Benchmark() {
+        vkDestroyQueryPool(device.device, query_pool, nullptr);
+    }
+
+    template<typename T>
+    std::unique_ptr<imr::Buffer> upload(std::vector<T>& data) {
+        auto buffer = std::make_unique<imr::Buffer>(device, std::max<size_t>(data.size() * sizeof(T), 4), usage);
+        buffer->uploadDataSync(0, data.size() * sizeof(T), data.data());
+        return buffer;
+    }
+
+    template<typename T>
+    std::vector<T> download(imr::Buffer& buffer, size_t count) {
+        std::vector<T> data(count);
+        if (count == 0)
+            return data;
+        imr::Buffer readback(device, count * sizeof(T), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        device.executeCommandsSync([&](VkCommandBuffer cmdbuf) {
+            vkCmdCopyBuffer(cmdbuf, buffer.handle, readback.handle, 1, tmpPtr((VkBufferCopy) { .size = count * sizeof(T) }));
+        });
+        void* mapped;
+        CHECK_VK(vkMapMemory(device.device, readback.memory, readback.memory_offset, readback.size, 0, &mapped), abort());
+        memcpy(data.data(), mapped, count * sizeof(T));
+        vkUnmapMemory(device.device, readback.memory);
+        return data;
+    }
+
+    /// `prepare` is recorded before the timed section, e.g. to restore inputs that get sorted in place
+    double time_gpu(std::function<void(VkCommandBuffer)> prepare, std::function<void(VkCommandBuffer)> run) {
+        double total_ms = 0;
+        for (int i = 0; i < iterations; i++) {
+            device.executeCommandsSync([&](VkCommandBuffer cmdbuf) {
+                prepare(cmdbuf);
+                vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, tmpPtr((VkMemoryBarrier) {
+                    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                }), 0, nullptr, 0, nullptr);
+                vkCmdResetQueryPool(cmdbuf, query_pool, 0, 2);
+                vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+                run(cmdbuf);
+                vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 1);
+            });
+            uint64_t timestamps[2];
+            vkGetQueryPoolResults(device.device, query_pool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+            total_ms += (timestamps[1] - timestamps[0]) * timestamp_period / 1000000.0;
+        }
+        return total_ms / iterations;
+    }
+
+    double time_cpu(std::function<void()> run) {
+        auto start = imr_get_time_nano();
+        for (int i = 0; i < iterations; i++)
+            run();
+        return (imr_get_time_nano() - start) / 1000000.0 / iterations;
+    }
+
+    template<typename T>
+    bool report(const char* name, const std::vector<T>& expected, const std::vector<T>& got, double gpu_ms, double cpu_ms, size_t count) {
+        auto mismatch = std::mismatch(expected.begin(), expected.end(), got.begin(), got.end());
+        bool ok = mismatch.first == expected.end() && mismatch.second == got.end();
+        printf("%-16s %s  gpu %8.3f ms (%7.1f Melem/s)  cpu %8.3f ms\n", name, ok ? "ok  " : "FAIL", gpu_ms, count / gpu_ms / 1000.0, cpu_ms);
+        if (!ok && mismatch.first != expected.end())
+            printf("  first mismatch at %zu\n", (size_t) (mismatch.first - expected.begin()));
+        return ok;
+    }
+};
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? strtoul(argv[1], nullptr, 0) : 1 << 20;
+    int iterations = argc > 2 ? atoi(argv[2]) : 10;
+
+    imr::Context context;
+    imr::Device device(context, context.fastest_device(imr::Workload::Compute));
+    Benchmark bench(device, iterations);
+    auto& caps = device.compute_capabilities();
+    printf("%u elements on %s (subgroup size %u, %u-%u with size control)\n", count, device.physical_device.properties.deviceName, caps.subgroup_size, caps.min_subgroup_size, caps.max_subgroup_size);
+
+    std::mt19937 rng(42);
+    std::vector<uint32_t> values(count);
+    std::vector<uint32_t> flags(count);
+    std::vector<uint32_t> keys32(count);
+    std::vector<uint64_t> keys64(count);
+    std::vector<uint32_t> payloads(count);
+    for (uint32_t i = 0; i < count; i++) {
+        values[i] = rng() % 16;
+        flags[i] = rng() % 3 == 0;
+        keys32[i] = rng();
+        keys64[i] = (uint64_t(rng()) << 32) | rng();
+        payloads[i] = i;
+    }
+
+    bool ok = true;
+    auto& primitives = bench.primitives;
+
+    {
+        auto input = bench.upload(values);
+        auto output = std::make_unique<imr::Buffer>(device, count * sizeof(uint32_t), usage);
+        imr::Buffer scratch(device, imr::ComputePrimitives::scan_scratch_size(count), usage);
+        double gpu = bench.time_gpu([](VkCommandBuffer) {}, [&](VkCommandBuffer cmdbuf) {
+            primitives.exclusive_scan(cmdbuf, input->device_address(), output->device_address(), count, scratch);
+        });
+        std::vector<uint32_t> expected;
+        double cpu = bench.time_cpu([&]() { expected = reference::exclusive_scan(values); });
+        ok &= bench.report("exclusive_scan", expected, bench.download<uint32_t>(*output, count), gpu, cpu, count);
+    }
+
+    {
+        auto input = bench.upload(values);
+        auto flags_buffer = bench.upload(flags);
+        auto output = std::make_unique<imr::Buffer>(device, count * sizeof(uint32_t), usage);
+        auto out_count = std::make_unique<imr::Buffer>(device, sizeof(uint32_t), usage);
+        imr::Buffer scratch(device, imr::ComputePrimitives::compact_scratch_size(count), usage);
+        double gpu = bench.time_gpu([](VkCommandBuffer) {}, [&](VkCommandBuffer cmdbuf) {
+            primitives.compact(cmdbuf, input->device_address(), flags_buffer->device_address(), output->device_address(), out_count->device_address(), count, scratch);
+        });
+        std::vector<uint32_t> expected;
+        double cpu = bench.time_cpu([&]() { expected = reference::compact(values, flags); });
+        uint32_t got_count = bench.download<uint32_t>(*out_count, 1)[0];
+        ok &= bench.report("compact", expected, bench.download<uint32_t>(*output, std::min(got_count, count)), gpu, cpu, count);
+    }
+
+    auto sort = [&]<typename K>(const char* name, std::vector<K>& keys) {
+        uint32_t key_bits = sizeof(K) * 8;
+        auto pristine_keys = bench.upload(keys);
+        auto pristine_payloads = bench.upload(payloads);
+        auto keys_buffer = std::make_unique<imr::Buffer>(device, count * sizeof(K), usage);
+        auto keys_alt = std::make_unique<imr::Buffer>(device, count * sizeof(K), usage);
+        auto payloads_buffer = std::make_unique<imr::Buffer>(device, count * sizeof(uint32_t), usage);
+        auto payloads_alt = std::make_unique<imr::Buffer>(device, count * sizeof(uint32_t), usage);
+        imr::Buffer scratch(device, imr::ComputePrimitives::radix_sort_scratch_size(count, key_bits), usage);
+
+        double gpu = bench.time_gpu([&](VkCommandBuffer cmdbuf) {
+            vkCmdCopyBuffer(cmdbuf, pristine_keys->handle, keys_buffer->handle, 1, tmpPtr((VkBufferCopy) { .size = count * sizeof(K) }));
+            vkCmdCopyBuffer(cmdbuf, pristine_payloads->handle, payloads_buffer->handle, 1, tmpPtr((VkBufferCopy) { .size = count * sizeof(uint32_t) }));
+        }, [&](VkCommandBuffer cmdbuf) {
+            primitives.radix_sort(cmdbuf, key_bits, keys_buffer->device_address(), keys_alt->device_address(), payloads_buffer->device_address(), payloads_alt->device_address(), count, scratch);
+        });
+
+        std::vector<K> expected_keys;
+        std::vector<uint32_t> expected_payloads;
+        double cpu = bench.time_cpu([&]() {
+            expected_keys = keys;
+            expected_payloads = payloads;
+            reference::radix_sort(expected_keys, expected_payloads);
+        });
+        ok &= bench.report(name, expected_keys, bench.download<K>(*keys_buffer, count), gpu, cpu, count);
+        // the sort is stable, so the payloads must match exactly too
+        ok &= bench.report("  payloads", expected_payloads, bench.download<uint32_t>(*payloads_buffer, count), gpu, cpu, count);
+    };
+    sort("radix_sort_32", keys32);
+    sort("radix_sort_64", keys64);
+
+    return ok ? 0 : 1;
+}
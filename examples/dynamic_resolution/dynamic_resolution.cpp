@@ -0,0 +1,71 @@
+#include "imr/imr.h"
+#include "imr/util.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// Renders an expensive fractal at whatever resolution fits in the frame time budget
+// usage: dynamic_resolution [--budget <ms>] [--iterations <n>] [--bilinear]
+
+int main(int argc, char** argv) {
+    imr::DynamicResolution::Options options;
+    options.min_scale = 0.25f;
+    uint32_t iterations = 1024;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+            options.target_frame_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            iterations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bilinear") == 0)
+            options.edge_aware_upscale = false;
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    auto window = glfwCreateWindow(1024, 1024, "Example", nullptr, nullptr);
+
+    imr::Context context;
+    imr::Device device(context);
+    imr::Swapchain swapchain(device, window);
+    imr::DynamicResolution dynamic_resolution(swapchain, options);
+    imr::FpsCounter fps_counter;
+    imr::ComputePipeline shader(device, "dynamic_resolution.spv");
+
+    auto start = imr_get_time_nano();
+    size_t frames = 0;
+    while (!glfwWindowShouldClose(window)) {
+        fps_counter.tick();
+        fps_counter.updateGlfwWindowTitle(window);
+
+        dynamic_resolution.renderFrame([&](imr::DynamicResolution::RenderContext& context) {
+            auto cmdbuf = context.cmdbuf;
+            shader.bind(cmdbuf);
+            auto shader_bind_helper = shader.create_bind_helper();
+            shader_bind_helper->set_storage_image(0, 0, context.image);
+            shader_bind_helper->commit(cmdbuf);
+
+            struct {
+                uint32_t render_size[2];
+                float time;
+                uint32_t iterations;
+            } push_constants = {
+                { context.render_size.width, context.render_size.height },
+                (float) ((imr_get_time_nano() - start) / 1000000000.0),
+                iterations,
+            };
+            shader.dispatch(cmdbuf, push_constants, { context.render_size.width, context.render_size.height, 1 });
+
+            context.frame.addCleanupAction([=]() {
+                delete shader_bind_helper;
+            });
+        });
+
+        if (++frames % 300 == 0)
+            printf("scale: %.2f, gpu time: %.3f ms\n", dynamic_resolution.scale(), dynamic_resolution.gpu_frame_time());
+
+        glfwPollEvents();
+    }
+
+    swapchain.drain();
+    return 0;
+}
@@ -0,0 +1,36 @@
+#version 450
+#extension GL_EXT_shader_image_load_formatted : require
+#extension GL_EXT_scalar_block_layout : require
+
+layout(set = 0, binding = 0)
+uniform image2D renderTarget;
+
+layout(scalar, push_constant) uniform T {
+    ivec2 render_size;
+    float time;
+    uint iterations;
+} push_constants;
+
+layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+
+float mandelbrot(vec2 c) {
+    vec2 z = vec2(0.0);
+    uint i = 0;
+    for (; i < push_constants.iterations && dot(z, z) < 4.0; i++)
+        z = vec2(z.x * z.x - z.y * z.y, 2.0 * z.x * z.y) + c;
+    return float(i) / float(push_constants.iterations);
+}
+
+void main() {
+    // the target is bigger than what gets presented, only the corner we were given counts
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    if (pixel.x >= push_constants.render_size.x || pixel.y >= push_constants.render_size.y)
+        return;
+    vec2 size = vec2(push_constants.render_size);
+
+    float zoom = 1.5 + sin(push_constants.time * 0.3);
+    vec2 c = ((vec2(pixel) + 0.5) - size * 0.5) / size.y * zoom * 2.0 + vec2(-0.75, 0.1);
+    vec3 color = sqrt(mandelbrot(c)) * vec3(1.0, 0.6, 0.2);
+
+    imageStore(renderTarget, pixel, vec4(color, 1.0));
+}
@@ -0,0 +1,93 @@
+#include "imr/imr.h"
+#include "imr/util.h"
+
+#include "VkBootstrap.h"
+
+#include <cstring>
+#include <memory>
+
+// Renders with every available GPU, alternating frames between them or splitting each frame in bands
+// usage: multi_device [--split]
+
+int main(int argc, char** argv) {
+    auto mode = imr::MultiDeviceRenderer::Mode::AlternateFrame;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--split") == 0)
+            mode = imr::MultiDeviceRenderer::Mode::SplitFrame;
+        else if (strcmp(argv[i], "--afr") == 0)
+            mode = imr::MultiDeviceRenderer::Mode::AlternateFrame;
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    auto window = glfwCreateWindow(1024, 1024, "Example", nullptr, nullptr);
+
+    imr::Context context;
+    // the default device presents, every other one just helps
+    std::vector<std::unique_ptr<imr::Device>> devices;
+    devices.push_back(std::make_unique<imr::Device>(context));
+    for (auto& physical_device : context.available_devices()) {
+        if (physical_device.physical_device != devices[0]->physical_device.physical_device)
+            devices.push_back(std::make_unique<imr::Device>(context, physical_device));
+    }
+
+    std::vector<imr::Device*> device_ptrs;
+    std::vector<std::unique_ptr<imr::ComputePipeline>> shaders;
+    for (auto& device : devices) {
+        printf("device %zu: %s\n", device_ptrs.size(), device->physical_device.properties.deviceName);
+        device_ptrs.push_back(device.get());
+        shaders.push_back(std::make_unique<imr::ComputePipeline>(*device, "multi_device.spv", "main", imr::ComputePipelineOptions { .push_descriptors = true }));
+    }
+
+    imr::Swapchain swapchain(*devices[0], window);
+    imr::MultiDeviceRenderer renderer(swapchain, device_ptrs, mode);
+    imr::FpsCounter fps_counter;
+
+    auto start = imr_get_time_nano();
+    size_t frames = 0;
+    while (!glfwWindowShouldClose(window)) {
+        fps_counter.tick();
+        fps_counter.updateGlfwWindowTitle(window);
+
+        renderer.renderFrame([&](imr::MultiDeviceRenderer::RenderContext& context) {
+            size_t device_index = 0;
+            while (device_ptrs[device_index] != &context.device)
+                device_index++;
+            auto& shader = *shaders[device_index];
+            auto cmdbuf = context.cmdbuf;
+
+            shader.bind(cmdbuf);
+            auto shader_bind_helper = shader.create_bind_helper();
+            shader_bind_helper->set_storage_image(0, 0, context.image);
+            shader_bind_helper->commit(cmdbuf);
+
+            struct {
+                int32_t region_offset[2];
+                uint32_t region_size[2];
+                float time;
+                uint32_t device_index;
+            } push_constants = {
+                { context.region.offset.x, context.region.offset.y },
+                { context.region.extent.width, context.region.extent.height },
+                (float) ((imr_get_time_nano() - start) / 1000000000.0),
+                (uint32_t) device_index,
+            };
+            shader.dispatch(cmdbuf, push_constants, { context.region.extent.width, context.region.extent.height, 1 });
+
+            context.addCleanupAction([=]() {
+                delete shader_bind_helper;
+            });
+        });
+
+        if (++frames % 300 == 0) {
+            auto times = renderer.device_frame_times();
+            for (size_t i = 0; i < times.size(); i++)
+                printf("device %zu: %.3f ms%s", i, times[i], i + 1 == times.size() ? "\n" : ", ");
+        }
+
+        glfwPollEvents();
+    }
+
+    renderer.drain();
+    return 0;
+}
@@ -0,0 +1,41 @@
+#version 450
+#extension GL_EXT_shader_image_load_formatted : require
+#extension GL_EXT_scalar_block_layout : require
+
+layout(set = 0, binding = 0)
+uniform image2D renderTarget;
+
+layout(scalar, push_constant) uniform T {
+    ivec2 region_offset;
+    ivec2 region_size;
+    float time;
+    uint device_index;
+} push_constants;
+
+layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+
+// something that takes a bit of work per pixel, so the devices have a reason to share it
+float mandelbrot(vec2 c) {
+    vec2 z = vec2(0.0);
+    int i = 0;
+    for (; i < 256 && dot(z, z) < 4.0; i++)
+        z = vec2(z.x * z.x - z.y * z.y, 2.0 * z.x * z.y) + c;
+    return float(i) / 256.0;
+}
+
+void main() {
+    if (gl_GlobalInvocationID.x >= push_constants.region_size.x || gl_GlobalInvocationID.y >= push_constants.region_size.y)
+        return;
+    ivec2 pixel = push_constants.region_offset + ivec2(gl_GlobalInvocationID.xy);
+    vec2 img_size = vec2(imageSize(renderTarget));
+
+    float zoom = 1.5 + sin(push_constants.time * 0.3);
+    vec2 c = (vec2(pixel) - img_size * 0.5) / img_size.y * zoom * 2.0 + vec2(-0.75, 0.1);
+    float m = mandelbrot(c);
+
+    // tint by device so the split is visible
+    vec3 tints[4] = { vec3(1.0, 0.6, 0.2), vec3(0.2, 0.8, 1.0), vec3(0.6, 1.0, 0.3), vec3(1.0, 0.3, 0.8) };
+    vec3 color = sqrt(m) * tints[push_constants.device_index % 4];
+
+    imageStore(renderTarget, pixel, vec4(color, 1.0));
+}
@@ -4,68 +4,36 @@ int main() {
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     auto window = glfwCreateWindow(1024, 1024, "Example", nullptr, nullptr);
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
 
     imr::Context context;
     imr::Device device(context);
     imr::Swapchain swapchain(device, window);
     imr::FpsCounter fps_counter;
+    imr::CpuRaster raster;
 
-    // CPU-side staging buffer
-    uint8_t* framebuffer = reinterpret_cast<uint8_t*>(malloc(width * height * 4));
-
-    std::unique_ptr<imr::Buffer> buffer = std::make_unique<imr::Buffer>(device, width * height * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-    uint8_t* mapped_buffer;
-    CHECK_VK(vkMapMemory(device.device, buffer->memory, buffer->memory_offset, buffer->size, 0, (void**) &mapped_buffer), abort());
-
-    VkFence fence;
-    vkCreateFence(device.device, tmpPtr((VkFenceCreateInfo) {
-        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-        .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-    }), nullptr, &fence);
-
+    uint32_t frame = 0;
     while (!glfwWindowShouldClose(window)) {
-        using Frame = imr::Swapchain::Frame;
-        swapchain.beginFrame([&](Frame& frame) {
-            int nwidth = frame.image().size().width;
-            int nheight = frame.image().size().height;
-
-            if (nwidth != width || nheight != height) {
-                width = nwidth;
-                height = nheight;
-                free(framebuffer);
-                framebuffer = reinterpret_cast<uint8_t*>(malloc(width * height * 4));
-
-                // unmap the old gpu buffer and reallocate it
-                vkUnmapMemory(device.device, buffer->memory);
-                buffer = std::make_unique<imr::Buffer>(device, width * height * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-                CHECK_VK(vkMapMemory(device.device, buffer->memory, buffer->memory_offset, buffer->size, 0, (void**) &mapped_buffer), abort());
-            }
-
-            vkWaitForFences(device.device, 1, &fence, VK_TRUE, UINT64_MAX);
-            CHECK_VK(vkResetFences(device.device, 1, &fence), abort());
-
-            for (size_t i = 0 ; i < width; i++) {
-                for (size_t j = 0; j < height; j++) {
-                    framebuffer[((j * width) + i) * 4 + 0] = rand() % 255;
-                    framebuffer[((j * width) + i) * 4 + 1] = rand() % 255;
-                    framebuffer[((j * width) + i) * 4 + 2] = rand() % 255;
+        // we write straight into memory the GPU copies from, every swapchain image has its own buffer
+        swapchain.renderFrameFromHost([&](imr::Swapchain::HostRenderContext& context) {
+            // rows are shaded in parallel, so rand() is out: hash the pixel coordinates instead
+            raster.shade_rows(context, [&](uint32_t y, uint32_t* row) {
+                for (uint32_t x = 0; x < context.size.width; x++) {
+                    uint32_t h = (x * 0x8da6b343u) ^ (y * 0xd8163841u) ^ (frame * 0xcb1ab31fu);
+                    h ^= h >> 15;
+                    h *= 0x2c1b3c6du;
+                    h ^= h >> 12;
+                    row[x] = h | 0xff000000u;
                 }
-            }
-            memcpy(mapped_buffer, framebuffer, width * height * 4);
-            frame.presentFromBuffer(buffer->handle, fence, std::nullopt);
+            });
         });
+        frame++;
 
         fps_counter.tick();
         fps_counter.updateGlfwWindowTitle(window);
         glfwPollEvents();
     }
 
-    vkDeviceWaitIdle(device.device);
-    free(framebuffer);
-
-    vkDestroyFence(device.device, fence, nullptr);
+    swapchain.drain();
 
     return 0;
 }
@@ -164,14 +164,14 @@ int main() {
             }));
 
             vkEndCommandBuffer(cmdbuf);
-            vk.queueSubmit(device.main_queue, 1, tmpPtr((VkSubmitInfo) {
+            device.submit((VkSubmitInfo) {
                 .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
                 .waitSemaphoreCount = 0,
                 .commandBufferCount = 1,
                 .pCommandBuffers = &cmdbuf,
                 .signalSemaphoreCount = 1,
                 .pSignalSemaphores = &sem,
-            }), VK_NULL_HANDLE);
+            }, VK_NULL_HANDLE);
 
             frame.addCleanupAction([=, &device]() {
                 vkDestroySemaphore(device.device, sem, nullptr);
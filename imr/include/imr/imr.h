@@ -22,6 +22,29 @@ inline T* tmpPtr(T&& t) { return &t; }
 
 namespace imr {
 
+/// What a device is mostly going to be used for, when picking the fastest one
+enum class Workload {
+    /// Shader arithmetic and device memory bandwidth
+    Compute,
+    /// Streaming data from the host
+    Transfer,
+    /// A bit of both
+    Mixed,
+};
+
+/// Results of the built-in device micro-benchmark
+struct DeviceBenchmark {
+    /// FMA-bound compute kernel
+    double compute_gflops;
+    /// Host-visible to device-local buffer copy
+    double upload_gbps;
+    /// Device-local to device-local buffer copy
+    double copy_gbps;
+
+    /// Higher is better, only comparable between devices for the same workload
+    double score(Workload) const;
+};
+
 struct Context {
     Context(std::function<void(vkb::InstanceBuilder&)>&& instance_custom = [](auto&) {});
     Context(Context&) = delete;
@@ -31,6 +54,63 @@ struct Context {
     vkb::InstanceDispatchTable dispatch;
 
     std::vector<vkb::PhysicalDevice> available_devices(std::function<void(vkb::PhysicalDeviceSelector&)>&& device_custom = [](auto&) {});
+
+    /// Benchmarks each of `available_devices`, this takes a device creation and some milliseconds of work per device.
+    /// Results are cached on disk per device and driver version, in $IMR_DEVICE_CACHE or the user's cache directory.
+    std::vector<std::pair<vkb::PhysicalDevice, DeviceBenchmark>> benchmark_devices(std::function<void(vkb::PhysicalDeviceSelector&)>&& device_custom = [](auto&) {});
+    /// The device of `available_devices` that benchmarks fastest for this workload, to use with Device(Context&, vkb::PhysicalDevice)
+    vkb::PhysicalDevice fastest_device(Workload, std::function<void(vkb::PhysicalDeviceSelector&)>&& device_custom = [](auto&) {});
+};
+
+/// Subgroup and compute shader properties of a device
+struct ComputeCapabilities {
+    /// The default subgroup size, in the absence of any requirement
+    uint32_t subgroup_size;
+    VkShaderStageFlags subgroup_stages;
+    VkSubgroupFeatureFlags subgroup_operations;
+
+    /// Whether pipelines can ask for a required subgroup size, only meaningful in `required_subgroup_size_stages`
+    bool subgroup_size_control;
+    /// Whether compute pipelines can ask for all their subgroups to be fully populated
+    bool compute_full_subgroups;
+    uint32_t min_subgroup_size;
+    uint32_t max_subgroup_size;
+    VkShaderStageFlags required_subgroup_size_stages;
+    uint32_t max_compute_workgroup_subgroups;
+
+    uint32_t max_compute_shared_memory_size;
+    uint32_t max_compute_workgroup_invocations;
+    uint32_t max_compute_workgroup_size[3];
+    uint32_t max_compute_workgroup_count[3];
+
+    bool supports(VkSubgroupFeatureFlags operations, VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT) const { return (subgroup_operations & operations) == operations && (subgroup_stages & stages) == stages; }
+};
+
+/// Optional features, enabled whenever the device has them. imr falls back to slower paths when they are missing.
+struct DeviceFeatures {
+    /// VK_EXT_memory_budget, makes Device::device_local_memory_budget() exact rather than estimated
+    bool memory_budget;
+    /// VK_EXT_memory_priority, render targets get to stay in video memory longer under pressure
+    bool memory_priority;
+    /// VK_KHR_push_descriptor, see ComputePipelineOptions::push_descriptors
+    bool push_descriptor;
+    /// Non-uniform indexing, runtime arrays, partially bound and update-after-bind descriptors. Required by BindlessTable and runtime-sized descriptor arrays
+    bool descriptor_indexing;
+    bool storage_buffer_8bit;
+    bool storage_buffer_16bit;
+    bool shader_int64;
+    /// 64-bit atomics on storage buffers, e.g. for packing depth and an ID into one atomicMin
+    bool buffer_int64_atomics;
+    /// VK_EXT_external_memory_host, see Buffer's host pointer constructor
+    bool external_memory_host;
+    /// VK_KHR_incremental_present, see Swapchain::Frame::addDirtyRegion
+    bool incremental_present;
+};
+
+/// In bytes, summed over the device-local heaps
+struct MemoryBudget {
+    uint64_t usage;
+    uint64_t budget;
 };
 
 struct Device {
@@ -52,6 +132,25 @@ struct Device {
     vkb::DispatchTable dispatch;
 
     void executeCommandsSync(std::function<void(VkCommandBuffer)>);
+    /// Submits to main_queue, the queue is externally synchronised so threads sharing it must go through these.
+    /// Both flush whatever was queued with enqueueSubmit first, in the same call for submit.
+    VkResult submit(const VkSubmitInfo&, VkFence);
+    VkResult present(const VkPresentInfoKHR&);
+    /// Queues a submission without handing it to the driver yet, its fence can't be waited on before flushSubmits (or the next submit or present)
+    VkResult enqueueSubmit(const VkSubmitInfo&, VkFence = VK_NULL_HANDLE);
+    VkResult flushSubmits();
+
+    /// Returns a sampler matching the create info, samplers are cached and owned by the device
+    VkSampler sampler(const VkSamplerCreateInfo&);
+    static VkSamplerCreateInfo linear_sampler_info(VkSamplerAddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
+
+    /// Subgroup size control and full subgroups are enabled when the device supports them
+    const ComputeCapabilities& compute_capabilities() const;
+    const DeviceFeatures& features() const;
+    /// What this process uses and may use of the device-local memory
+    MemoryBudget device_local_memory_budget() const;
+    /// Host pointers and sizes imported into buffers must be multiples of this, 0 without DeviceFeatures::external_memory_host
+    size_t host_import_alignment() const;
 
     class Impl;
     std::unique_ptr<Impl> _impl;
@@ -59,6 +158,9 @@ struct Device {
 
 struct Buffer {
     Buffer(Device&, size_t size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_property = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    /// Wraps caller-owned host memory without copying it, needs DeviceFeatures::external_memory_host.
+    /// `host_pointer` and `size` must be multiples of Device::host_import_alignment(), and the memory must outlive the buffer.
+    Buffer(Device&, void* host_pointer, size_t size, VkBufferUsageFlags usage);
     Buffer(Buffer&) = delete;
     ~Buffer();
 
@@ -73,10 +175,47 @@ struct Buffer {
     void uploadDataSync(uint64_t offset, uint64_t size, void* data);
     void ubo_upload(const void* data, size_t n) const;
 
+    /// Only for host-visible buffers. Mappings are reference-counted, every map() needs a matching unmap(). Imported buffers just return their host pointer
+    void* map();
+    void unmap();
+
     struct Impl;
     std::unique_ptr<Impl> _impl;
 };
 
+enum class FormatNumericType : uint8_t {
+    Unknown,
+    UNorm,
+    SNorm,
+    UScaled,
+    SScaled,
+    UInt,
+    SInt,
+    UFloat,
+    SFloat,
+    /// Combined depth/stencil formats, each aspect has its own numeric type
+    Mixed,
+};
+
+/// Static properties of a VkFormat. For block-compressed formats the size is given per block rather than per texel.
+struct FormatInfo {
+    VkImageAspectFlags aspects;
+    /// Bytes per texel or per block, zero for multi-planar formats
+    uint8_t block_size;
+    uint8_t block_width;
+    uint8_t block_height;
+    uint8_t channels;
+    bool srgb;
+    FormatNumericType numeric_type;
+
+    bool is_compressed() const { return block_width > 1 || block_height > 1; }
+    /// Size in bytes of a tightly packed region of that extent, rounded up to whole blocks
+    VkDeviceSize size_for(VkExtent3D extent) const;
+};
+
+/// O(1) lookup into a constexpr table, throws on formats we know nothing about
+const FormatInfo& format_info(VkFormat);
+
 /// Deals with the common use-cases for images, allocating memory for you and tracking properties.
 /// Does not track image layouts for you, much of the framework assumes VK_IMAGE_LAYOUT_GENERAL
 struct Image {
@@ -103,6 +242,7 @@ private:
 
 struct ShaderModule {
     ShaderModule(imr::Device& device, std::string&& filename) noexcept(false);
+    ShaderModule(imr::Device& device, std::vector<uint32_t>&& spirv) noexcept(false);
     ShaderModule(const ShaderModule&) = delete;
     ShaderModule(ShaderModule&&) = default;
 
@@ -136,8 +276,11 @@ struct DescriptorBindHelper {
     DescriptorBindHelper(DescriptorBindHelper&) = delete;
     ~DescriptorBindHelper();
 
-    void set_storage_image(uint32_t set, uint32_t binding, Image& image, std::optional<VkImageSubresourceRange> = std::nullopt, std::optional<VkImageViewType> = std::nullopt);
-    void set_combined_image_sampler(uint32_t set, uint32_t binding, Image& image, VkSampler sampler);
+    /// array_element selects the slot when the binding is an array of descriptors
+    void set_storage_image(uint32_t set, uint32_t binding, Image& image, std::optional<VkImageSubresourceRange> = std::nullopt, std::optional<VkImageViewType> = std::nullopt, uint32_t array_element = 0);
+    void set_combined_image_sampler(uint32_t set, uint32_t binding, Image& image, VkSampler sampler, std::optional<VkImageSubresourceRange> = std::nullopt, std::optional<VkImageViewType> = std::nullopt, uint32_t array_element = 0);
+    /// Uniform or storage texel buffer, whichever the shader declares
+    void set_texel_buffer(uint32_t set, uint32_t binding, Buffer& buffer, VkFormat format, size_t offset = 0, size_t range = VK_WHOLE_SIZE, uint32_t array_element = 0);
     void set_uniform_buffer(const Device &device, uint32_t set, uint32_t binding, Buffer &buffer, size_t offset = 0, size_t range =
                                     VK_WHOLE_SIZE) const;
     void commit(VkCommandBuffer);
@@ -146,8 +289,64 @@ struct DescriptorBindHelper {
     std::unique_ptr<Impl> _impl;
 };
 
+/// One long-lived descriptor set holding arrays of images, using descriptor indexing (update-after-bind, partially bound).
+/// Images are registered once and keep a stable index for as long as they stay in the table.
+/// Pipelines opt into it (ComputePipelineOptions::bindless_table, or the GraphicsPipeline constructor) and then use its layout for `set_index`, so it can be bound with any of them.
+///
+/// In shaders:
+///   layout(set = N, binding = 0) uniform sampler2D textures[];
+///   layout(set = N, binding = 1) uniform image2D images[];
+struct BindlessTable {
+    static constexpr uint32_t sampled_images_binding = 0;
+    static constexpr uint32_t storage_images_binding = 1;
+
+    BindlessTable(Device&, uint32_t set_index, uint32_t capacity = 1024);
+    BindlessTable(BindlessTable&) = delete;
+    ~BindlessTable();
+
+    /// The image is expected to be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL when sampled
+    uint32_t add_sampled_image(Image&, VkSampler, std::optional<VkImageViewType> = std::nullopt);
+    /// The image is expected to be in VK_IMAGE_LAYOUT_GENERAL when accessed
+    uint32_t add_storage_image(Image&, std::optional<VkImageViewType> = std::nullopt);
+    /// The index may be reused right away, the GPU must be done with it
+    void remove_sampled_image(uint32_t index);
+    void remove_storage_image(uint32_t index);
+
+    uint32_t set_index() const;
+    VkDescriptorSetLayout set_layout() const;
+    VkDescriptorSet set() const;
+
+    void bind(VkCommandBuffer, VkPipelineBindPoint, VkPipelineLayout) const;
+
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+/// A member of a shader's push constant block, as laid out by the shader
+struct PushConstantMember {
+    /// Empty if the module was stripped of debug names
+    std::string name;
+    uint32_t offset;
+    uint32_t size;
+};
+
+/// Validated against the device's ComputeCapabilities, pipeline creation throws if they can't be honoured
+struct ComputePipelineOptions {
+    /// Needs ComputeCapabilities::subgroup_size_control
+    std::optional<uint32_t> required_subgroup_size;
+    /// Every subgroup is fully populated, which also makes `gl_SubgroupID * gl_SubgroupSize + gl_SubgroupInvocationID` dense. Needs ComputeCapabilities::compute_full_subgroups
+    bool full_subgroups = false;
+    /// Lets DescriptorBindHelper push the first plain descriptor set rather than allocate one, when the device has DeviceFeatures::push_descriptor.
+    /// set_layout() of that set can't be used to allocate descriptor sets then.
+    bool push_descriptors = false;
+    /// Use this table's layout for its set index, the shader's bindings in that set must match it
+    BindlessTable* bindless_table = nullptr;
+};
+
 struct ComputePipeline {
-    ComputePipeline(Device&, std::string&& spirv_filename, std::string&& entrypoint_name = "main");
+    ComputePipeline(Device&, std::string&& spirv_filename, std::string&& entrypoint_name = "main", ComputePipelineOptions = {});
+    /// For shaders embedded in the program rather than loaded from a file
+    ComputePipeline(Device&, std::vector<uint32_t>&& spirv, std::string&& entrypoint_name = "main", ComputePipelineOptions = {});
     ComputePipeline(ComputePipeline&) = delete;
     ~ComputePipeline();
 
@@ -157,6 +356,46 @@ struct ComputePipeline {
 
     DescriptorBindHelper* create_bind_helper();
 
+    const std::vector<PushConstantMember>& push_constant_members() const;
+    const PushConstantMember* push_constant_member(const std::string& name) const;
+    /// Size of the push constant block, including any members that precede the range this pipeline uses
+    uint32_t push_constants_size() const;
+    /// Throws if the shader's workgroup size isn't a compile-time constant
+    VkExtent3D workgroup_size() const;
+
+    /// Binds the pipeline and forgets what was pushed previously, use this instead of vkCmdBindPipeline when using dispatch()
+    void bind(VkCommandBuffer cmdbuf);
+    /// Pushes the parts of `push_constants` that changed since the last dispatch() in this command buffer, and dispatches enough workgroups to cover `global_size` invocations
+    /// Any other vkCmdPushConstants in between requires calling bind() again
+    void dispatch(VkCommandBuffer cmdbuf, const void* push_constants, size_t size, VkExtent3D global_size);
+    void dispatch(VkCommandBuffer cmdbuf, VkExtent3D global_size) { dispatch(cmdbuf, nullptr, 0, global_size); }
+    template<typename T>
+    void dispatch(VkCommandBuffer cmdbuf, const T& push_constants, VkExtent3D global_size) { dispatch(cmdbuf, &push_constants, sizeof(T), global_size); }
+
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+/// Data-parallel building blocks for GPU-driven rendering, working on device addresses of arrays of 32-bit elements (or 64-bit sort keys)
+/// Barriers between their own dispatches are recorded for you, synchronizing with what comes before and after is up to the caller
+/// `scratch` buffers need VK_BUFFER_USAGE_TRANSFER_DST_BIT, be at least the corresponding *_scratch_size() and can't be shared by calls in flight at the same time
+struct ComputePrimitives {
+    ComputePrimitives(Device&);
+    ComputePrimitives(ComputePrimitives&) = delete;
+    ~ComputePrimitives();
+
+    static size_t scan_scratch_size(uint32_t count);
+    static size_t compact_scratch_size(uint32_t count);
+    static size_t radix_sort_scratch_size(uint32_t count, uint32_t key_bits);
+
+    /// output[i] = input[0] + ... + input[i - 1], input and output can be the same
+    void exclusive_scan(VkCommandBuffer, VkDeviceAddress input, VkDeviceAddress output, uint32_t count, Buffer& scratch);
+    /// Copies input[i] where flags[i] != 0 to output, preserving their order, and writes how many there were to *out_count. output can't alias input.
+    void compact(VkCommandBuffer, VkDeviceAddress input, VkDeviceAddress flags, VkDeviceAddress output, VkDeviceAddress out_count, uint32_t count, Buffer& scratch);
+    /// Stable ascending sort of 32 or 64-bit unsigned keys (the latter stored as little-endian uint64_t), optionally carrying a 32-bit payload per key
+    /// The `alt` buffers are used for ping-ponging, the result ends up in `keys` and `payloads`. Pass 0 for both payload addresses when there are none.
+    void radix_sort(VkCommandBuffer, uint32_t key_bits, VkDeviceAddress keys, VkDeviceAddress keys_alt, VkDeviceAddress payloads, VkDeviceAddress payloads_alt, uint32_t count, Buffer& scratch);
+
     struct Impl;
     std::unique_ptr<Impl> _impl;
 };
@@ -191,7 +430,8 @@ struct GraphicsPipeline {
     static VkPipelineRasterizationStateCreateInfo solid_filled_polygons();
     static VkPipelineDepthStencilStateCreateInfo simple_depth_testing();
 
-    GraphicsPipeline(Device&, std::vector<ShaderEntryPoint*>&& stages, RenderTargetsState, StateBuilder);
+    /// With a `bindless_table`, its layout is used for its set index, see ComputePipelineOptions::bindless_table
+    GraphicsPipeline(Device&, std::vector<ShaderEntryPoint*>&& stages, RenderTargetsState, StateBuilder, BindlessTable* bindless_table = nullptr);
     GraphicsPipeline(const GraphicsPipeline&) = delete;
     ~GraphicsPipeline();
 
@@ -214,10 +454,16 @@ struct Swapchain {
 
     /// Approximate FPS cap, avoids melting your GPU on a trivial scene
     int maxFps = 999;
+    /// Hands frames to a dedicated thread for presenting, so throttling and blocking presents don't hold up recording the next frame
+    bool asyncPresent = false;
 
     struct Frame {
         void presentFromBuffer(VkBuffer buffer, VkFence signal_when_reusable, std::optional<VkSemaphore> sem);
         void presentFromImage(VkImage image, VkFence signal_when_reusable, std::optional<VkSemaphore> sem, VkImageLayout src_layout = VK_IMAGE_LAYOUT_GENERAL, std::optional<VkExtent2D> image_size = std::nullopt);
+        /// Like presentFromImage, but upscales with an edge-aware compute filter followed by sharpening (FSR1-style EASU + RCAS) rather than a bilinear blit.
+        /// `image` has to be in VK_IMAGE_LAYOUT_GENERAL and have storage usage, only its `image_size` corner is read.
+        /// `sharpness_stops` of 0 sharpens the most, every stop halves it. Falls back to the blit if the swapchain's format can't be a storage image.
+        void presentUpscaled(Image& image, VkFence signal_when_reusable, std::optional<VkSemaphore> sem, std::optional<VkExtent2D> image_size = std::nullopt, float sharpness_stops = 0.2f);
 
         size_t id;
         Image& image() const;
@@ -228,6 +474,11 @@ struct Swapchain {
         void addCleanupFence(VkFence fence);
         void addCleanupAction(std::function<void(void)>&& fn);
 
+        /// Declares that only this rectangle changed since the previous frame. Call before presenting, may be called several times.
+        /// presentFromBuffer then only copies what this swapchain image is missing, and the compositor is told which regions to update if the device has incremental_present.
+        /// Frames that declare no regions are treated as entirely dirty.
+        void addDirtyRegion(VkRect2D region);
+
         void withRenderTargets(VkCommandBuffer, std::vector<Image*> color_images, Image* depth, std::function<void()> f);
 
         class Impl;
@@ -255,6 +506,19 @@ struct Swapchain {
     /// Simplified API to draw a frame, deals with cmdbuf allocation, recording and submission, as well as layout transitions in and out of VK_IMAGE_LAYOUT_GENERAL for the swapchain image
     void renderFrameSimplified(std::function<void(SimplifiedRenderContext&)>&& fn);
 
+    struct HostRenderContext {
+        /// Persistently mapped and host-coherent: `size.height` rows of `row_pitch` bytes each, in `format`
+        uint8_t* pixels;
+        VkExtent2D size;
+        size_t row_pitch;
+        VkFormat format;
+        Swapchain::Frame& frame;
+    };
+
+    /// For CPU renderers: `fn` writes the frame straight into a host-visible buffer owned by the swapchain image, whose copy to the image is recorded once.
+    /// Each image has its own buffer, so the CPU can fill the next one while the copies of the previous ones are in flight.
+    void renderFrameFromHost(std::function<void(HostRenderContext&)>&& fn);
+
     void resize();
 
     /// Waits until all the in-flight frames are done and runs their cleanup jobs
@@ -264,6 +528,147 @@ struct Swapchain {
     std::unique_ptr<Impl> _impl;
 };
 
+/// Spreads the rendering of a swapchain's frames over several devices, and brings the results back to the device that presents
+/// Other devices render into their own images, which go through host memory to reach the presenting device
+struct MultiDeviceRenderer {
+    enum class Mode {
+        /// Each frame is rendered entirely by one device, with up to one frame in flight per device. Frames are presented in order.
+        AlternateFrame,
+        /// Each frame is split into horizontal bands, one per device, sized after how fast each device has been.
+        /// A frame is presented by the next renderFrame() call, so the devices keep working while the application prepares the next one.
+        SplitFrame,
+    };
+
+    struct RenderContext {
+        Device& device;
+        VkCommandBuffer cmdbuf;
+        /// Frame-sized and in VK_IMAGE_LAYOUT_GENERAL, only `region` needs to be written
+        Image& image;
+        VkRect2D region;
+        size_t frame_id;
+
+        /// Runs once the device is done with this command buffer
+        void addCleanupAction(std::function<void(void)>&& fn);
+
+        struct Impl;
+        Impl* _impl;
+    };
+
+    /// `devices` has to contain the swapchain's device
+    MultiDeviceRenderer(Swapchain&, std::vector<Device*> devices, Mode);
+    MultiDeviceRenderer(MultiDeviceRenderer&) = delete;
+    ~MultiDeviceRenderer();
+
+    /// `fn` is called once per device taking part in the frame, and records into the given command buffer
+    void renderFrame(std::function<void(RenderContext&)>&& fn);
+
+    /// Moving average of the GPU time each device spent on its share of a frame, in milliseconds (0 until measured), in the order the devices were given
+    std::vector<double> device_frame_times() const;
+
+    /// Presents any frame still in flight, and waits for all devices to be done
+    void drain();
+
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+/// Runs the simulation and the rendering on two threads, so that updating the next frame overlaps recording and executing the current one.
+/// They hand frames over through three snapshot slots: the simulation always has a slot of its own to write, the renderer always reads the newest complete one.
+/// Keep the snapshots in an array of `snapshot_count` and index it with the slot passed to the callbacks.
+struct FrameLoop {
+    static constexpr uint32_t snapshot_count = 3;
+
+    FrameLoop(Swapchain&, GLFWwindow*);
+    FrameLoop(FrameLoop&) = delete;
+    ~FrameLoop();
+
+    /// Runs until the window is closed. `simulate` runs on the calling thread, which has to be the one GLFW runs on, and polls the events first.
+    /// `render` runs on a render thread, with the swapchain all to itself, and only once per new snapshot.
+    /// The simulation gets one snapshot ahead of the renderer at most, exceptions in either end the loop and are rethrown here.
+    void run(std::function<void(uint32_t slot, double delta_seconds)>&& simulate, std::function<void(uint32_t slot, Swapchain::SimplifiedRenderContext&)>&& render);
+
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+/// Small per-frame constants, like camera matrices, that the host keeps updating until right before the GPU needs them, to cut input latency.
+/// Every frame in flight gets its own persistently mapped, host-coherent copy, which shaders read through its device address.
+struct LatchedConstants {
+    LatchedConstants(Device&, size_t size);
+    LatchedConstants(LatchedConstants&) = delete;
+    ~LatchedConstants();
+
+    /// Picks a copy nothing in flight reads anymore, which `frame` holds on to until it gets recycled, and returns its address
+    VkDeviceAddress begin_frame(Swapchain::Frame& frame);
+    /// Makes the GPU wait at this point of `cmdbuf` until latch() is called, which can then happen after submission.
+    /// The GPU stalls on it, so latch() must follow promptly, or it will be forced by the next begin_frame() with whatever the copy holds
+    void defer(VkCommandBuffer cmdbuf);
+    /// Writes this frame's values. Without defer() this has to happen before the command buffer is submitted
+    void latch(const void* data);
+
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+/// Renders below the swapchain's resolution when the GPU can't hold a frame time budget, and upscales when presenting.
+/// The render target is allocated at the largest scale once and only a corner of it is rendered to, so scale changes never reallocate.
+struct DynamicResolution {
+    struct Options {
+        /// GPU time to aim for per frame, in milliseconds
+        double target_frame_ms = 1000.0 / 60.0;
+        /// Scales apply to both dimensions of the swapchain extent
+        float min_scale = 0.5f;
+        float max_scale = 1.0f;
+        VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+        /// Upscales with Swapchain::Frame::presentUpscaled rather than a bilinear blit, which holds up better at low scales
+        bool edge_aware_upscale = true;
+        float sharpness_stops = 0.2f;
+    };
+
+    struct RenderContext {
+        VkCommandBuffer cmdbuf;
+        /// In VK_IMAGE_LAYOUT_GENERAL and sized for `max_scale`, only the `render_size` corner at the origin is presented
+        Image& image;
+        VkExtent2D render_size;
+        Swapchain::Frame& frame;
+    };
+
+    DynamicResolution(Swapchain&, Options options);
+    DynamicResolution(DynamicResolution&) = delete;
+    ~DynamicResolution();
+
+    /// `fn` records the frame's rendering, which is timed on the GPU to pick the scale of the following frames
+    void renderFrame(std::function<void(RenderContext&)>&& fn);
+
+    float scale() const;
+    /// Moving average, in milliseconds (0 until measured)
+    double gpu_frame_time() const;
+
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+/// Shades CPU-rendered frames of 32-bit pixels on a pool of threads. The frame is cut into bands of rows small enough to stay in cache,
+/// each row is shaded into thread-local memory and then streamed into the destination with SIMD stores, which suits write-combined mappings.
+struct CpuRaster {
+    /// Counting the calling thread, which takes part in the work. 0 uses every hardware thread
+    explicit CpuRaster(unsigned threads = 0);
+    CpuRaster(CpuRaster&) = delete;
+    ~CpuRaster();
+
+    unsigned thread_count() const;
+
+    /// `shade(y, row)` fills the `size.width` pixels of row `y`, it gets called from several threads at once
+    void shade_rows(uint8_t* pixels, VkExtent2D size, size_t row_pitch, const std::function<void(uint32_t y, uint32_t* row)>& shade);
+    void shade_rows(Swapchain::HostRenderContext&, const std::function<void(uint32_t y, uint32_t* row)>& shade);
+    /// Sets every pixel to `value`
+    void fill(uint8_t* pixels, VkExtent2D size, size_t row_pitch, uint32_t value);
+    void fill(Swapchain::HostRenderContext&, uint32_t value);
+
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
 struct FpsCounter {
     FpsCounter();
     FpsCounter(FpsCounter&) = delete;
@@ -0,0 +1,184 @@
+#include "imr_private.h"
+
+namespace imr {
+
+struct BindlessTable::Impl {
+    Device& device;
+    uint32_t set_index;
+    uint32_t capacity;
+
+    VkDescriptorSetLayout set_layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet set;
+
+    struct Slots {
+        std::vector<VkImageView> views;
+        std::vector<uint32_t> free_list;
+        uint32_t next = 0;
+
+        uint32_t acquire(uint32_t capacity) {
+            if (!free_list.empty()) {
+                uint32_t index = free_list.back();
+                free_list.pop_back();
+                return index;
+            }
+            if (next == capacity)
+                throw std::runtime_error("BindlessTable is full");
+            views.push_back(VK_NULL_HANDLE);
+            return next++;
+        }
+    };
+    Slots sampled;
+    Slots storage;
+
+    Impl(Device& device, uint32_t set_index, uint32_t capacity) : device(device), set_index(set_index), capacity(capacity) {}
+
+    VkImageView make_view(Image& image, std::optional<VkImageViewType> view_type) {
+        VkImageViewType final_view_type = view_type ? *view_type : image_type_to_view_type(image.type());
+        if (!view_type && image.layerCount > 1 && image.type() == VK_IMAGE_TYPE_2D)
+            final_view_type = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+
+        VkImageView view;
+        CHECK_VK_THROW(vkCreateImageView(device.device, tmpPtr((VkImageViewCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = image.handle(),
+            .viewType = final_view_type,
+            .format = image.format(),
+            .subresourceRange = image.whole_image_subresource_range(),
+        }), nullptr, &view));
+        return view;
+    }
+
+    void release(Slots& slots, uint32_t index) {
+        assert(index < slots.views.size() && slots.views[index] != VK_NULL_HANDLE);
+        vkDestroyImageView(device.device, slots.views[index], nullptr);
+        slots.views[index] = VK_NULL_HANDLE;
+        slots.free_list.push_back(index);
+    }
+};
+
+BindlessTable::BindlessTable(Device& device, uint32_t set_index, uint32_t capacity) {
+    if (!device.features().descriptor_indexing)
+        throw std::runtime_error("BindlessTable needs a device with descriptor indexing");
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexing_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES,
+    };
+    vkGetPhysicalDeviceProperties2(device.physical_device, tmpPtr((VkPhysicalDeviceProperties2) {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &indexing_properties,
+    }));
+    if (capacity > indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages || capacity > indexing_properties.maxDescriptorSetUpdateAfterBindStorageImages)
+        throw std::runtime_error("BindlessTable capacity exceeds the device limits for update-after-bind descriptors");
+
+    _impl = std::make_unique<Impl>(device, set_index, capacity);
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {
+            .binding = sampled_images_binding,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = capacity,
+            .stageFlags = VK_SHADER_STAGE_ALL,
+        },
+        {
+            .binding = storage_images_binding,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = capacity,
+            .stageFlags = VK_SHADER_STAGE_ALL,
+        },
+    };
+    // Slots can be empty, and can be (re)written while the set is bound as long as the GPU doesn't read those particular slots
+    std::vector<VkDescriptorBindingFlags> binding_flags = {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+    };
+    // the layout cache owns it, so pipeline layouts keyed on it stay valid after the table is gone
+    _impl->set_layout = device._impl->layouts.get_set_layout(device, bindings, binding_flags, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
+
+    VkDescriptorPoolSize pool_sizes[] = {
+        { .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = capacity },
+        { .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = capacity },
+    };
+    CHECK_VK_THROW(vkCreateDescriptorPool(device.device, tmpPtr((VkDescriptorPoolCreateInfo) {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets = 1,
+        .poolSizeCount = 2,
+        .pPoolSizes = pool_sizes,
+    }), nullptr, &_impl->pool));
+
+    CHECK_VK_THROW(vkAllocateDescriptorSets(device.device, tmpPtr((VkDescriptorSetAllocateInfo) {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = _impl->pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &_impl->set_layout,
+    }), &_impl->set));
+}
+
+uint32_t BindlessTable::add_sampled_image(Image& image, VkSampler sampler, std::optional<VkImageViewType> view_type) {
+    auto& device = _impl->device;
+    uint32_t index = _impl->sampled.acquire(_impl->capacity);
+    VkImageView view = _impl->make_view(image, view_type);
+    _impl->sampled.views[index] = view;
+
+    vkUpdateDescriptorSets(device.device, 1, tmpPtr((VkWriteDescriptorSet) {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = _impl->set,
+        .dstBinding = sampled_images_binding,
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = tmpPtr((VkDescriptorImageInfo) {
+            .sampler = sampler,
+            .imageView = view,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        }),
+    }), 0, nullptr);
+    return index;
+}
+
+uint32_t BindlessTable::add_storage_image(Image& image, std::optional<VkImageViewType> view_type) {
+    auto& device = _impl->device;
+    uint32_t index = _impl->storage.acquire(_impl->capacity);
+    VkImageView view = _impl->make_view(image, view_type);
+    _impl->storage.views[index] = view;
+
+    vkUpdateDescriptorSets(device.device, 1, tmpPtr((VkWriteDescriptorSet) {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = _impl->set,
+        .dstBinding = storage_images_binding,
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        .pImageInfo = tmpPtr((VkDescriptorImageInfo) {
+            .sampler = VK_NULL_HANDLE,
+            .imageView = view,
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        }),
+    }), 0, nullptr);
+    return index;
+}
+
+void BindlessTable::remove_sampled_image(uint32_t index) { _impl->release(_impl->sampled, index); }
+void BindlessTable::remove_storage_image(uint32_t index) { _impl->release(_impl->storage, index); }
+
+uint32_t BindlessTable::set_index() const { return _impl->set_index; }
+VkDescriptorSetLayout BindlessTable::set_layout() const { return _impl->set_layout; }
+VkDescriptorSet BindlessTable::set() const { return _impl->set; }
+
+void BindlessTable::bind(VkCommandBuffer cmdbuf, VkPipelineBindPoint bind_point, VkPipelineLayout layout) const {
+    vkCmdBindDescriptorSets(cmdbuf, bind_point, layout, _impl->set_index, 1, &_impl->set, 0, nullptr);
+}
+
+BindlessTable::~BindlessTable() {
+    auto& device = _impl->device;
+    for (auto view : _impl->sampled.views)
+        if (view)
+            vkDestroyImageView(device.device, view, nullptr);
+    for (auto view : _impl->storage.views)
+        if (view)
+            vkDestroyImageView(device.device, view, nullptr);
+    vkDestroyDescriptorPool(device.device, _impl->pool, nullptr);
+}
+
+}
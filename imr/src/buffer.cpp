@@ -1,7 +1,12 @@
 #include "imr_private.h"
 
+#include <cstring>
+
 namespace imr {
 
+/// Below this, importing the caller's memory costs more than a staging copy
+static constexpr uint64_t min_import_upload_size = 1024 * 1024;
+
 struct Buffer::Impl {
     Device& device;
     VkBufferUsageFlags usage;
@@ -9,6 +14,10 @@ struct Buffer::Impl {
 
     VmaAllocation allocation;
     VmaAllocationInfo allocation_info;
+
+    /// Set instead of `allocation` for buffers wrapping imported host memory
+    VkDeviceMemory imported_memory = VK_NULL_HANDLE;
+    void* host_pointer = nullptr;
 };
 
 Buffer::Buffer(imr::Device& device, size_t size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_property) : size(size) {
@@ -30,6 +39,72 @@ Buffer::Buffer(imr::Device& device, size_t size, VkBufferUsageFlags usage, VkMem
     memory_offset = _impl->allocation_info.offset;
 }
 
+Buffer::Buffer(Device& device, void* host_pointer, size_t size, VkBufferUsageFlags usage) : size(size) {
+    size_t alignment = device.host_import_alignment();
+    if (!device.features().external_memory_host)
+        throw std::runtime_error("Importing host memory needs VK_EXT_external_memory_host");
+    if (reinterpret_cast<uintptr_t>(host_pointer) % alignment != 0 || size % alignment != 0)
+        throw std::runtime_error("Imported host memory must be aligned to Device::host_import_alignment()");
+
+    VkMemoryHostPointerPropertiesEXT pointer_properties = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT,
+    };
+    CHECK_VK_THROW(device.dispatch.getMemoryHostPointerPropertiesEXT(VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, host_pointer, &pointer_properties));
+
+    CHECK_VK_THROW(vkCreateBuffer(device.device, tmpPtr((VkBufferCreateInfo) {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = tmpPtr((VkExternalMemoryBufferCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO,
+            .handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+        }),
+        .size = size,
+        .usage = usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    }), nullptr, &handle));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device.device, handle, &requirements);
+
+    // coherent, so host writes to the caller's memory need no flushing
+    const VkPhysicalDeviceMemoryProperties* memory_properties;
+    vmaGetMemoryProperties(device._impl->allocator, &memory_properties);
+    std::optional<uint32_t> memory_type;
+    for (uint32_t i = 0; i < memory_properties->memoryTypeCount && !memory_type; i++) {
+        if ((pointer_properties.memoryTypeBits & requirements.memoryTypeBits & (1u << i)) && (memory_properties->memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+            memory_type = i;
+    }
+    if (!memory_type) {
+        vkDestroyBuffer(device.device, handle, nullptr);
+        throw std::runtime_error("No host-coherent memory type can import this host pointer");
+    }
+
+    _impl = std::make_unique<Impl>(device, usage, memory_properties->memoryTypes[*memory_type].propertyFlags);
+    _impl->host_pointer = host_pointer;
+    VkResult result = vkAllocateMemory(device.device, tmpPtr((VkMemoryAllocateInfo) {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = tmpPtr((VkImportMemoryHostPointerInfoEXT) {
+            .sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT,
+            .pNext = tmpPtr((VkMemoryAllocateFlagsInfo) {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
+                .flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
+            }),
+            .handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+            .pHostPointer = host_pointer,
+        }),
+        .allocationSize = size,
+        .memoryTypeIndex = *memory_type,
+    }), nullptr, &_impl->imported_memory);
+    if (result == VK_SUCCESS)
+        result = vkBindBufferMemory(device.device, handle, _impl->imported_memory, 0);
+    if (result != VK_SUCCESS) {
+        vkDestroyBuffer(device.device, handle, nullptr);
+        vkFreeMemory(device.device, _impl->imported_memory, nullptr);
+        throw std::runtime_error("Failed to import host memory");
+    }
+    memory = _impl->imported_memory;
+    memory_offset = 0;
+}
+
 VkDeviceAddress Buffer::device_address() {
     return vkGetBufferDeviceAddress(_impl->device.device, tmpPtr((VkBufferDeviceAddressInfo) {
         .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
@@ -40,6 +115,10 @@ VkDeviceAddress Buffer::device_address() {
 // For UBO, does not unmap memory again.
 // https://gpuopen-librariesandsdks.github.io/VulkanMemoryAllocator/html/memory_mapping.html
 void Buffer::ubo_upload(const void* data, const size_t n) const {
+    if (_impl->host_pointer) {
+        memcpy(_impl->host_pointer, data, n);
+        return;
+    }
     void* mapped_buffer;
     CHECK_VK_THROW(vmaMapMemory(_impl->device._impl->allocator, _impl->allocation, &mapped_buffer));
     memcpy(mapped_buffer, data, n);
@@ -47,25 +126,57 @@ void Buffer::ubo_upload(const void* data, const size_t n) const {
     // (the allocation might still be unmapped by uploadDataSync, don't know how to prevent)
 }
 
+void* Buffer::map() {
+    if (!(_impl->memory_property & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+        throw std::runtime_error("Only host-visible buffers can be mapped");
+    if (_impl->host_pointer)
+        return _impl->host_pointer;
+    void* mapped;
+    CHECK_VK_THROW(vmaMapMemory(_impl->device._impl->allocator, _impl->allocation, &mapped));
+    return mapped;
+}
+
+void Buffer::unmap() {
+    if (_impl->host_pointer)
+        return;
+    vmaUnmapMemory(_impl->device._impl->allocator, _impl->allocation);
+}
 
 void Buffer::uploadDataSync(uint64_t offset, uint64_t size, void* data) {
     auto& device = _impl->device;
-    if (_impl->memory_property & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    if (_impl->host_pointer) {
+        memcpy(static_cast<uint8_t*>(_impl->host_pointer) + offset, data, size);
+    } else if (_impl->memory_property & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
         CHECK_VK_THROW(vmaCopyMemoryToAllocation(_impl->device._impl->allocator, data, _impl->allocation, offset, size));
     } else if (_impl->usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) {
-        // TODO: be less ridiculous, import host memory
-        auto staging = imr::Buffer(device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-        staging.uploadDataSync(0, size, data);
+        // big uploads are copied straight out of the caller's memory, by importing the whole pages around it
+        std::unique_ptr<Buffer> source;
+        uint64_t source_offset = 0;
+        if (size >= min_import_upload_size && device.features().external_memory_host) {
+            size_t alignment = device.host_import_alignment();
+            uintptr_t begin = reinterpret_cast<uintptr_t>(data) / alignment * alignment;
+            uintptr_t end = (reinterpret_cast<uintptr_t>(data) + size + alignment - 1) / alignment * alignment;
+            try {
+                source = std::make_unique<Buffer>(device, reinterpret_cast<void*>(begin), end - begin, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+                source_offset = reinterpret_cast<uintptr_t>(data) - begin;
+            } catch (std::runtime_error&) {
+                // not all memory can be imported (e.g. some file mappings), fall back to staging
+            }
+        }
+        if (!source) {
+            source = std::make_unique<Buffer>(device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+            source->uploadDataSync(0, size, data);
+        }
 
         device.executeCommandsSync([&](VkCommandBuffer cmdbuf) {
             vkCmdCopyBuffer2(cmdbuf, tmpPtr((VkCopyBufferInfo2) {
                 .sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
-                .srcBuffer = staging.handle,
+                .srcBuffer = source->handle,
                 .dstBuffer = handle,
                 .regionCount = 1,
                 .pRegions = tmpPtr((VkBufferCopy2) {
                     .sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
-                    .srcOffset = 0,
+                    .srcOffset = source_offset,
                     .dstOffset = offset,
                     .size = size,
                 })
@@ -77,6 +188,11 @@ void Buffer::uploadDataSync(uint64_t offset, uint64_t size, void* data) {
 }
 
 Buffer::~Buffer() {
+    if (_impl->imported_memory) {
+        vkDestroyBuffer(_impl->device.device, handle, nullptr);
+        vkFreeMemory(_impl->device.device, _impl->imported_memory, nullptr);
+        return;
+    }
     vmaDestroyBuffer(_impl->device._impl->allocator, handle, _impl->allocation);
 }
 
@@ -0,0 +1,83 @@
+#include "shader_private.h"
+
+#include <cstddef>
+#include <cstring>
+
+namespace imr {
+
+/// Changed regions closer than this are pushed together, one bigger vkCmdPushConstants is cheaper than several tiny ones
+static constexpr uint32_t push_merge_distance = 16;
+
+const std::vector<PushConstantMember>& ComputePipeline::push_constant_members() const { return _impl->push_constant_members; }
+
+const PushConstantMember* ComputePipeline::push_constant_member(const std::string& name) const {
+    for (auto& member : _impl->push_constant_members)
+        if (member.name == name)
+            return &member;
+    return nullptr;
+}
+
+uint32_t ComputePipeline::push_constants_size() const {
+    auto& range = _impl->push_constant_range;
+    return range ? range->offset + range->size : 0;
+}
+
+VkExtent3D ComputePipeline::workgroup_size() const {
+    if (!_impl->workgroup_size)
+        throw std::runtime_error("The workgroup size of this pipeline is not known at reflection time");
+    return *_impl->workgroup_size;
+}
+
+void ComputePipeline::bind(VkCommandBuffer cmdbuf) {
+    vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, _impl->pipeline);
+    _impl->pushed_cmdbuf = cmdbuf;
+    _impl->pushed.clear();
+}
+
+void ComputePipeline::dispatch(VkCommandBuffer cmdbuf, const void* push_constants, size_t size, VkExtent3D global_size) {
+    if (_impl->pushed_cmdbuf != cmdbuf)
+        throw std::runtime_error("ComputePipeline::bind() must be called on this command buffer before dispatch()");
+
+    uint32_t expected = push_constants_size();
+    // the host struct may have tail padding up to its alignment, but anything beyond that is a layout mismatch
+    constexpr uint32_t host_alignment = alignof(std::max_align_t);
+    uint32_t padded = (expected + host_alignment - 1) / host_alignment * host_alignment;
+    if (size < expected || size > padded)
+        throw std::runtime_error("Push constants are " + std::to_string(size) + " bytes but the shader expects " + std::to_string(expected));
+
+    if (expected > 0) {
+        auto& range = *_impl->push_constant_range;
+        auto data = static_cast<const uint8_t*>(push_constants);
+        auto& pushed = _impl->pushed;
+        auto push = [&](uint32_t begin, uint32_t end) {
+            vkCmdPushConstants(cmdbuf, _impl->layout->pipeline_layout, range.stageFlags, begin, end - begin, data + begin);
+        };
+
+        if (pushed.size() != expected) {
+            push(range.offset, expected);
+        } else {
+            // offsets and sizes of vkCmdPushConstants need to be multiples of 4, and so are the range bounds
+            std::optional<uint32_t> run_begin;
+            uint32_t run_end = 0;
+            for (uint32_t offset = range.offset; offset < expected; offset += 4) {
+                if (memcmp(data + offset, pushed.data() + offset, 4) == 0)
+                    continue;
+                if (run_begin && offset - run_end >= push_merge_distance) {
+                    push(*run_begin, run_end);
+                    run_begin.reset();
+                }
+                if (!run_begin)
+                    run_begin = offset;
+                run_end = offset + 4;
+            }
+            if (run_begin)
+                push(*run_begin, run_end);
+        }
+        pushed.assign(data, data + expected);
+    }
+
+    VkExtent3D wg = workgroup_size();
+    vkCmdDispatch(cmdbuf, (global_size.width + wg.width - 1) / wg.width, (global_size.height + wg.height - 1) / wg.height, (global_size.depth + wg.depth - 1) / wg.depth);
+}
+
+}
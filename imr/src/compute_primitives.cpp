@@ -0,0 +1,204 @@
+#include "imr_private.h"
+
+#include <cstdint>
+
+// generated by glslang from src/kernels/
+#include "scan.spv.h"
+#include "compact.spv.h"
+#include "radix_sort_histogram.spv.h"
+#include "radix_sort_histogram_64.spv.h"
+#include "radix_sort_onesweep.spv.h"
+#include "radix_sort_onesweep_64.spv.h"
+
+namespace imr {
+
+/// These must match the kernels
+static constexpr uint32_t scan_tile_size = 256 * 8;
+static constexpr uint32_t histogram_tile_size = 256 * 8;
+static constexpr uint32_t onesweep_tile_size_32 = 256 * 8;
+static constexpr uint32_t onesweep_tile_size_64 = 256 * 4;
+static constexpr uint32_t radix = 256;
+static constexpr uint32_t scan_state_words_per_partition = 3;
+/// The onesweep lookback packs a 2-bit flag with the counts
+static constexpr uint32_t max_sort_count = 1u << 30;
+
+static uint32_t partitions(uint32_t count, uint32_t tile_size) {
+    return (count + tile_size - 1) / tile_size;
+}
+
+struct ComputePrimitives::Impl {
+    Device& device;
+    ComputePipeline scan;
+    ComputePipeline compact;
+    ComputePipeline histogram_32;
+    ComputePipeline histogram_64;
+    ComputePipeline onesweep_32;
+    ComputePipeline onesweep_64;
+
+    Impl(Device& device, ComputePipelineOptions options) : device(device),
+        scan(device, embedded_spirv(imr_scan_spv), "main", options),
+        compact(device, embedded_spirv(imr_compact_spv), "main", options),
+        histogram_32(device, embedded_spirv(imr_radix_sort_histogram_spv)),
+        histogram_64(device, embedded_spirv(imr_radix_sort_histogram_64_spv)),
+        onesweep_32(device, embedded_spirv(imr_radix_sort_onesweep_spv), "main", options),
+        onesweep_64(device, embedded_spirv(imr_radix_sort_onesweep_64_spv), "main", options)
+        {}
+
+    /// Zeroes the part of the scratch buffer the kernel is going to use and makes that visible to it
+    void clear_scratch(VkCommandBuffer cmdbuf, Buffer& scratch, size_t size) {
+        if (scratch.size < size)
+            throw std::runtime_error("Scratch buffer is too small");
+        vkCmdFillBuffer(cmdbuf, scratch.handle, 0, size, 0);
+        device.dispatch.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = tmpPtr((VkMemoryBarrier2) {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT,
+                .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            })
+        }));
+    }
+
+    void compute_barrier(VkCommandBuffer cmdbuf) {
+        device.dispatch.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = tmpPtr((VkMemoryBarrier2) {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            })
+        }));
+    }
+};
+
+ComputePrimitives::ComputePrimitives(Device& device) {
+    // the workgroup scans index their data by subgroup, which wants full subgroups
+    ComputePipelineOptions options = {
+        .full_subgroups = device.compute_capabilities().compute_full_subgroups,
+    };
+    _impl = std::make_unique<Impl>(device, options);
+}
+
+size_t ComputePrimitives::scan_scratch_size(uint32_t count) {
+    return sizeof(uint32_t) * (1 + scan_state_words_per_partition * partitions(count, scan_tile_size));
+}
+
+size_t ComputePrimitives::compact_scratch_size(uint32_t count) { return scan_scratch_size(count); }
+
+/// Layout: histograms of every pass, then a partition counter per pass, then the lookback states of every pass
+size_t ComputePrimitives::radix_sort_scratch_size(uint32_t count, uint32_t key_bits) {
+    uint32_t passes = key_bits / 8;
+    uint32_t tile_size = key_bits == 64 ? onesweep_tile_size_64 : onesweep_tile_size_32;
+    return sizeof(uint32_t) * passes * (radix + 1 + radix * partitions(count, tile_size));
+}
+
+void ComputePrimitives::exclusive_scan(VkCommandBuffer cmdbuf, VkDeviceAddress input, VkDeviceAddress output, uint32_t count, Buffer& scratch) {
+    if (count == 0)
+        return;
+    _impl->clear_scratch(cmdbuf, scratch, scan_scratch_size(count));
+
+    struct {
+        VkDeviceAddress input;
+        VkDeviceAddress output;
+        VkDeviceAddress state;
+        uint32_t count;
+    } push_constants = { input, output, scratch.device_address(), count };
+
+    auto& shader = _impl->scan;
+    shader.bind(cmdbuf);
+    shader.dispatch(cmdbuf, push_constants, { partitions(count, scan_tile_size) * shader.workgroup_size().width, 1, 1 });
+}
+
+void ComputePrimitives::compact(VkCommandBuffer cmdbuf, VkDeviceAddress input, VkDeviceAddress flags, VkDeviceAddress output, VkDeviceAddress out_count, uint32_t count, Buffer& scratch) {
+    if (count == 0)
+        throw std::runtime_error("Can't compact an empty array");
+    _impl->clear_scratch(cmdbuf, scratch, compact_scratch_size(count));
+
+    struct {
+        VkDeviceAddress input;
+        VkDeviceAddress output;
+        VkDeviceAddress flags;
+        VkDeviceAddress out_count;
+        VkDeviceAddress state;
+        uint32_t count;
+    } push_constants = { input, output, flags, out_count, scratch.device_address(), count };
+
+    auto& shader = _impl->compact;
+    shader.bind(cmdbuf);
+    shader.dispatch(cmdbuf, push_constants, { partitions(count, scan_tile_size) * shader.workgroup_size().width, 1, 1 });
+}
+
+void ComputePrimitives::radix_sort(VkCommandBuffer cmdbuf, uint32_t key_bits, VkDeviceAddress keys, VkDeviceAddress keys_alt, VkDeviceAddress payloads, VkDeviceAddress payloads_alt, uint32_t count, Buffer& scratch) {
+    if (key_bits != 32 && key_bits != 64)
+        throw std::runtime_error("Only 32 and 64-bit keys can be sorted");
+    if (count >= max_sort_count)
+        throw std::runtime_error("Too many keys to sort");
+    if ((payloads == 0) != (payloads_alt == 0))
+        throw std::runtime_error("Both payload buffers have to be provided, or neither");
+    if (count == 0)
+        return;
+
+    bool key64 = key_bits == 64;
+    uint32_t passes = key_bits / 8;
+    uint32_t sort_partitions = partitions(count, key64 ? onesweep_tile_size_64 : onesweep_tile_size_32);
+    _impl->clear_scratch(cmdbuf, scratch, radix_sort_scratch_size(count, key_bits));
+
+    VkDeviceAddress histograms = scratch.device_address();
+    VkDeviceAddress counters = histograms + sizeof(uint32_t) * passes * radix;
+    VkDeviceAddress lookback = counters + sizeof(uint32_t) * passes;
+
+    struct {
+        VkDeviceAddress keys;
+        VkDeviceAddress histograms;
+        uint32_t count;
+    } histogram_push_constants = { keys, histograms, count };
+
+    auto& histogram = key64 ? _impl->histogram_64 : _impl->histogram_32;
+    histogram.bind(cmdbuf);
+    histogram.dispatch(cmdbuf, histogram_push_constants, { partitions(count, histogram_tile_size) * histogram.workgroup_size().width, 1, 1 });
+
+    struct {
+        VkDeviceAddress keys_in;
+        VkDeviceAddress keys_out;
+        VkDeviceAddress payloads_in;
+        VkDeviceAddress payloads_out;
+        VkDeviceAddress histogram;
+        VkDeviceAddress partition_counter;
+        VkDeviceAddress lookback;
+        uint32_t count;
+        uint32_t pass;
+        uint32_t has_payloads;
+    } onesweep_push_constants = {};
+
+    auto& onesweep = key64 ? _impl->onesweep_64 : _impl->onesweep_32;
+    onesweep.bind(cmdbuf);
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        _impl->compute_barrier(cmdbuf);
+
+        // even number of passes, so we end up back in the original buffers
+        bool flip = pass % 2 == 1;
+        onesweep_push_constants = {
+            .keys_in = flip ? keys_alt : keys,
+            .keys_out = flip ? keys : keys_alt,
+            .payloads_in = flip ? payloads_alt : payloads,
+            .payloads_out = flip ? payloads : payloads_alt,
+            .histogram = histograms + sizeof(uint32_t) * pass * radix,
+            .partition_counter = counters + sizeof(uint32_t) * pass,
+            .lookback = lookback + sizeof(uint32_t) * pass * radix * sort_partitions,
+            .count = count,
+            .pass = pass,
+            .has_payloads = payloads != 0,
+        };
+        onesweep.dispatch(cmdbuf, onesweep_push_constants, { sort_partitions * onesweep.workgroup_size().width, 1, 1 });
+    }
+}
+
+ComputePrimitives::~ComputePrimitives() {}
+
+}
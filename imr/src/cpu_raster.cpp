@@ -0,0 +1,184 @@
+#include "imr_private.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IMR_CPU_RASTER_SSE2
+#endif
+
+namespace imr {
+
+/// Bands are sized to roughly fit in L2 alongside the shading's own data
+static constexpr size_t band_bytes = 64 * 1024;
+
+/// Non-temporal stores skip reading the destination into cache, which for write-combined memory would be very slow
+static void stream_pixels(uint32_t* dst, const uint32_t* src, uint32_t count) {
+#ifdef IMR_CPU_RASTER_SSE2
+    uint32_t i = 0;
+    for (; i < count && (reinterpret_cast<uintptr_t>(dst + i) & 15) != 0; i++)
+        dst[i] = src[i];
+    for (; i + 4 <= count; i += 4)
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+    for (; i < count; i++)
+        dst[i] = src[i];
+#else
+    memcpy(dst, src, count * sizeof(uint32_t));
+#endif
+}
+
+static void stream_fill(uint32_t* dst, uint32_t value, uint32_t count) {
+#ifdef IMR_CPU_RASTER_SSE2
+    uint32_t i = 0;
+    for (; i < count && (reinterpret_cast<uintptr_t>(dst + i) & 15) != 0; i++)
+        dst[i] = value;
+    __m128i v = _mm_set1_epi32(static_cast<int>(value));
+    for (; i + 4 <= count; i += 4)
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    for (; i < count; i++)
+        dst[i] = value;
+#else
+    for (uint32_t i = 0; i < count; i++)
+        dst[i] = value;
+#endif
+}
+
+/// Makes the streaming stores visible before the band is reported done
+static void stream_fence() {
+#ifdef IMR_CPU_RASTER_SSE2
+    _mm_sfence();
+#endif
+}
+
+struct CpuRaster::Impl {
+    using Job = std::function<void(std::vector<uint32_t>& scratch, uint32_t band)>;
+
+    std::vector<std::thread> workers;
+    std::vector<uint32_t> caller_scratch;
+
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    uint64_t generation = 0;
+    bool quit = false;
+    uint32_t busy_workers = 0;
+
+    const Job* job = nullptr;
+    uint32_t bands = 0;
+    std::atomic<uint32_t> next_band;
+
+    void run_bands(std::vector<uint32_t>& scratch) {
+        for (uint32_t band; (band = next_band.fetch_add(1, std::memory_order_relaxed)) < bands;)
+            (*job)(scratch, band);
+        stream_fence();
+    }
+
+    void worker() {
+        std::vector<uint32_t> scratch;
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock lock(mutex);
+                work_ready.wait(lock, [&]() { return quit || generation != seen; });
+                if (quit)
+                    return;
+                seen = generation;
+            }
+            run_bands(scratch);
+            {
+                std::lock_guard lock(mutex);
+                if (--busy_workers == 0)
+                    work_done.notify_one();
+            }
+        }
+    }
+
+    /// Runs `fn` on every band, on all threads, and returns once they are done
+    void run(uint32_t band_count, const Job& fn) {
+        {
+            std::lock_guard lock(mutex);
+            job = &fn;
+            bands = band_count;
+            next_band.store(0, std::memory_order_relaxed);
+            busy_workers = static_cast<uint32_t>(workers.size());
+            generation++;
+        }
+        work_ready.notify_all();
+        run_bands(caller_scratch);
+
+        std::unique_lock lock(mutex);
+        work_done.wait(lock, [&]() { return busy_workers == 0; });
+        job = nullptr;
+    }
+
+    ~Impl() {
+        {
+            std::lock_guard lock(mutex);
+            quit = true;
+        }
+        work_ready.notify_all();
+        for (auto& thread : workers)
+            thread.join();
+    }
+};
+
+CpuRaster::CpuRaster(unsigned threads) {
+    _impl = std::make_unique<Impl>();
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 1; i < threads; i++)
+        _impl->workers.emplace_back([impl = _impl.get()]() { impl->worker(); });
+}
+
+CpuRaster::~CpuRaster() = default;
+
+unsigned CpuRaster::thread_count() const { return static_cast<unsigned>(_impl->workers.size()) + 1; }
+
+static uint32_t rows_per_band(size_t row_pitch) {
+    return static_cast<uint32_t>(std::max<size_t>(1, band_bytes / std::max<size_t>(1, row_pitch)));
+}
+
+void CpuRaster::shade_rows(uint8_t* pixels, VkExtent2D size, size_t row_pitch, const std::function<void(uint32_t y, uint32_t* row)>& shade) {
+    uint32_t band_rows = rows_per_band(row_pitch);
+    uint32_t bands = (size.height + band_rows - 1) / band_rows;
+    _impl->run(bands, [&](std::vector<uint32_t>& scratch, uint32_t band) {
+        scratch.resize(size.width);
+        uint32_t end = std::min(size.height, (band + 1) * band_rows);
+        for (uint32_t y = band * band_rows; y < end; y++) {
+            shade(y, scratch.data());
+            stream_pixels(reinterpret_cast<uint32_t*>(pixels + y * row_pitch), scratch.data(), size.width);
+        }
+    });
+}
+
+void CpuRaster::fill(uint8_t* pixels, VkExtent2D size, size_t row_pitch, uint32_t value) {
+    uint32_t band_rows = rows_per_band(row_pitch);
+    uint32_t bands = (size.height + band_rows - 1) / band_rows;
+    _impl->run(bands, [&](std::vector<uint32_t>&, uint32_t band) {
+        uint32_t end = std::min(size.height, (band + 1) * band_rows);
+        for (uint32_t y = band * band_rows; y < end; y++)
+            stream_fill(reinterpret_cast<uint32_t*>(pixels + y * row_pitch), value, size.width);
+    });
+}
+
+static void check_pixel_size(Swapchain::HostRenderContext& context) {
+    if (format_info(context.format).block_size != sizeof(uint32_t))
+        throw std::runtime_error("CpuRaster only handles 32-bit pixels");
+}
+
+void CpuRaster::shade_rows(Swapchain::HostRenderContext& context, const std::function<void(uint32_t y, uint32_t* row)>& shade) {
+    check_pixel_size(context);
+    shade_rows(context.pixels, context.size, context.row_pitch, shade);
+}
+
+void CpuRaster::fill(Swapchain::HostRenderContext& context, uint32_t value) {
+    check_pixel_size(context);
+    fill(context.pixels, context.size, context.row_pitch, value);
+}
+
+}
@@ -1,5 +1,7 @@
 #include "shader_private.h"
 
+#include <deque>
+
 namespace imr {
 
 struct DescriptorBindHelper::Impl {
@@ -10,12 +12,19 @@ struct DescriptorBindHelper::Impl {
 
     unsigned nsets;
     VkDescriptorSet* sets;
-    VkDescriptorPool pool;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+
+    /// Writes to the push descriptor set are kept around and pushed on every commit, along with what they point to
+    std::optional<uint32_t> push_set;
+    std::vector<VkWriteDescriptorSet> pushed_writes;
+    std::deque<VkDescriptorImageInfo> pushed_image_infos;
+    std::deque<VkDescriptorBufferInfo> pushed_buffer_infos;
+    std::deque<VkBufferView> pushed_texel_buffer_views;
 
     std::vector<std::function<void(void)>> cleanup;
     bool committed = false;
 
-    Impl(Device& device, PipelineLayout& layout, ReflectedLayout& reflected, VkPipelineBindPoint bind_point) : device(device), layout(layout), reflected(reflected), bind_point(bind_point) {
+    Impl(Device& device, PipelineLayout& layout, ReflectedLayout& reflected, VkPipelineBindPoint bind_point) : device(device), layout(layout), reflected(reflected), bind_point(bind_point), push_set(layout.push_descriptor_set) {
         auto& vk = device.dispatch;
         nsets = reflected.set_bindings.size();
 
@@ -26,6 +35,9 @@ struct DescriptorBindHelper::Impl {
             return descriptor_counts[key] = 0;
         };
         for (auto& [set, bindings] : reflected.set_bindings) {
+            // that one is allocated by the BindlessTable itself, and the push descriptor one isn't allocated at all
+            if (layout.bindless_set == set || push_set == set)
+                continue;
             for (auto& binding : bindings) {
                 access_map(binding.descriptorType) += binding.descriptorCount;
             }
@@ -40,19 +52,23 @@ struct DescriptorBindHelper::Impl {
             pool_sizes.push_back(size);
         }
 
-        vkCreateDescriptorPool(vk.device, tmpPtr((VkDescriptorPoolCreateInfo) {
-            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-            .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-            .maxSets = static_cast<uint32_t>(layout.set_layouts.size()),
-            .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
-            .pPoolSizes = pool_sizes.data(),
-        }), nullptr, &pool);
+        if (!pool_sizes.empty()) {
+            vkCreateDescriptorPool(vk.device, tmpPtr((VkDescriptorPoolCreateInfo) {
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                .maxSets = static_cast<uint32_t>(layout.set_layouts.size()),
+                .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
+                .pPoolSizes = pool_sizes.data(),
+            }), nullptr, &pool);
+        }
 
         sets = reinterpret_cast<VkDescriptorSet*>(calloc(nsets, sizeof(VkDescriptorSet)));
     }
 
     // Lazily allocates the set if we need it
     VkDescriptorSet get_or_create_set(unsigned set) {
+        if (layout.bindless_set == set)
+            throw std::runtime_error("This set is managed by the BindlessTable, register resources there instead");
         if (sets[set] == 0) {
             CHECK_VK_THROW(vkAllocateDescriptorSets(device.device, tmpPtr((VkDescriptorSetAllocateInfo) {
                 .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
@@ -64,6 +80,44 @@ struct DescriptorBindHelper::Impl {
         return sets[set];
     }
 
+    /// `write` can point to temporaries, dstSet is filled in here
+    void write(unsigned set, VkWriteDescriptorSet write) {
+        if (push_set == set) {
+            if (write.pImageInfo)
+                write.pImageInfo = &pushed_image_infos.emplace_back(*write.pImageInfo);
+            if (write.pBufferInfo)
+                write.pBufferInfo = &pushed_buffer_infos.emplace_back(*write.pBufferInfo);
+            if (write.pTexelBufferView)
+                write.pTexelBufferView = &pushed_texel_buffer_views.emplace_back(*write.pTexelBufferView);
+            // writing the same slot again replaces it
+            std::erase_if(pushed_writes, [&](const VkWriteDescriptorSet& w) { return w.dstBinding == write.dstBinding && w.dstArrayElement == write.dstArrayElement; });
+            pushed_writes.push_back(write);
+            return;
+        }
+        write.dstSet = get_or_create_set(set);
+        vkUpdateDescriptorSets(device.device, 1, &write, 0, nullptr);
+    }
+
+    void bind(VkCommandBuffer cmdbuf) {
+        for (unsigned set = 0; set < nsets; set++) {
+            if (sets[set])
+                vkCmdBindDescriptorSets(cmdbuf, bind_point, layout.pipeline_layout, set, 1, &sets[set], 0, nullptr);
+        }
+        if (!pushed_writes.empty())
+            device.dispatch.cmdPushDescriptorSetKHR(cmdbuf, bind_point, layout.pipeline_layout, *push_set, static_cast<uint32_t>(pushed_writes.size()), pushed_writes.data());
+    }
+
+    const VkDescriptorSetLayoutBinding* find_binding(unsigned set, uint32_t binding) const {
+        auto found = reflected.set_bindings.find(set);
+        if (found == reflected.set_bindings.end())
+            return nullptr;
+        for (auto& b : found->second) {
+            if (b.binding == binding)
+                return &b;
+        }
+        return nullptr;
+    }
+
     ~Impl() {
         free(sets);
         vkDestroyDescriptorPool(device.device, pool, nullptr);
@@ -99,7 +153,7 @@ VkImageViewType image_type_to_view_type(VkImageType type) {
     }
 }
 
-void DescriptorBindHelper::set_storage_image(uint32_t set, uint32_t binding, Image& image, std::optional<VkImageSubresourceRange> subresource, std::optional<VkImageViewType> image_view_type) {
+void DescriptorBindHelper::set_storage_image(uint32_t set, uint32_t binding, Image& image, std::optional<VkImageSubresourceRange> subresource, std::optional<VkImageViewType> image_view_type, uint32_t array_element) {
     assert(!_impl->committed);
     auto& device = _impl->device;
 
@@ -115,10 +169,10 @@ void DescriptorBindHelper::set_storage_image(uint32_t set, uint32_t binding, Ima
         .subresourceRange = subresource_range,
     }), nullptr, &view);
 
-    vkUpdateDescriptorSets(device.device, 1, tmpPtr((VkWriteDescriptorSet) {
+    _impl->write(set, (VkWriteDescriptorSet) {
         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet = _impl->get_or_create_set(set),
         .dstBinding = binding,
+        .dstArrayElement = array_element,
         .descriptorCount = 1,
         .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
         .pImageInfo = tmpPtr((VkDescriptorImageInfo) {
@@ -126,7 +180,7 @@ void DescriptorBindHelper::set_storage_image(uint32_t set, uint32_t binding, Ima
             .imageView = view,
             .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
         }),
-    }), 0, nullptr);
+    });
 
     auto deviceHandle = device.device.device;
     _impl->cleanup.push_back([=]() {
@@ -134,57 +188,36 @@ void DescriptorBindHelper::set_storage_image(uint32_t set, uint32_t binding, Ima
     });
 }
 
-void DescriptorBindHelper::set_combined_image_sampler(uint32_t set, uint32_t binding, Image& image, VkSampler sampler) {
+void DescriptorBindHelper::set_combined_image_sampler(uint32_t set, uint32_t binding, Image& image, VkSampler sampler, std::optional<VkImageSubresourceRange> subresource, std::optional<VkImageViewType> image_view_type, uint32_t array_element) {
     assert(!_impl->committed);
     auto& device = _impl->device;
 
-    VkImageSubresourceRange subresourceRange = image.whole_image_subresource_range();
-
-    subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    subresourceRange.baseMipLevel = 0;
-    subresourceRange.levelCount = 1;
-    subresourceRange.baseArrayLayer = 0;
-    subresourceRange.layerCount = image.layerCount;
+    VkImageViewType final_image_view_type = image_view_type ? *image_view_type : image_type_to_view_type(image.type());
+    if (!image_view_type && image.layerCount > 1 && image.type() == VK_IMAGE_TYPE_2D)
+        final_image_view_type = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    VkImageSubresourceRange subresource_range = subresource ? *subresource : image.whole_image_subresource_range();
 
-    VkImageViewCreateInfo createInfo = {
+    VkImageView view;
+    CHECK_VK_THROW(vkCreateImageView(device.device, tmpPtr((VkImageViewCreateInfo) {
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-        .pNext = nullptr,
-        .flags = 0,
         .image = image.handle(),
-        .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+        .viewType = final_image_view_type,
         .format = image.format(),
-        .components = {
-            .r = VK_COMPONENT_SWIZZLE_IDENTITY,
-            .g = VK_COMPONENT_SWIZZLE_IDENTITY,
-            .b = VK_COMPONENT_SWIZZLE_IDENTITY,
-            .a = VK_COMPONENT_SWIZZLE_IDENTITY,
-        },
-        .subresourceRange = subresourceRange,
-    };
-
-    VkImageView view;
-    vkCreateImageView(device.device, &createInfo, nullptr, &view);
-
-    VkDescriptorImageInfo imageInfo = {
-        .sampler = sampler,
-        .imageView = view,
-        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-    };
+        .subresourceRange = subresource_range,
+    }), nullptr, &view));
 
-    VkWriteDescriptorSet writeInfo = {
+    _impl->write(set, (VkWriteDescriptorSet) {
         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .pNext = nullptr,
-        .dstSet = _impl->get_or_create_set(set),
         .dstBinding = binding,
-        .dstArrayElement = 0,
+        .dstArrayElement = array_element,
         .descriptorCount = 1,
         .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-        .pImageInfo = &imageInfo,
-        .pBufferInfo = nullptr,
-        .pTexelBufferView = nullptr,
-    };
-
-    vkUpdateDescriptorSets(device.device, 1, &writeInfo, 0, nullptr);
+        .pImageInfo = tmpPtr((VkDescriptorImageInfo) {
+            .sampler = sampler,
+            .imageView = view,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        }),
+    });
 
     auto deviceHandle = device.device.device;
     _impl->cleanup.push_back([=]() {
@@ -192,10 +225,41 @@ void DescriptorBindHelper::set_combined_image_sampler(uint32_t set, uint32_t bin
     });
 }
 
+void DescriptorBindHelper::set_texel_buffer(uint32_t set, uint32_t binding, Buffer& buffer, VkFormat format, size_t offset, size_t range, uint32_t array_element) {
+    assert(!_impl->committed);
+    auto& device = _impl->device;
+
+    auto reflected_binding = _impl->find_binding(set, binding);
+    if (!reflected_binding || (reflected_binding->descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER && reflected_binding->descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER))
+        throw std::runtime_error("The shader has no texel buffer at that binding");
+
+    VkBufferView view;
+    CHECK_VK_THROW(vkCreateBufferView(device.device, tmpPtr((VkBufferViewCreateInfo) {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_VIEW_CREATE_INFO,
+        .buffer = buffer.handle,
+        .format = format,
+        .offset = offset,
+        .range = range,
+    }), nullptr, &view));
+
+    _impl->write(set, (VkWriteDescriptorSet) {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstBinding = binding,
+        .dstArrayElement = array_element,
+        .descriptorCount = 1,
+        .descriptorType = reflected_binding->descriptorType,
+        .pTexelBufferView = &view,
+    });
+
+    auto deviceHandle = device.device.device;
+    _impl->cleanup.push_back([=]() {
+        vkDestroyBufferView(deviceHandle, view, nullptr);
+    });
+}
+
 void DescriptorBindHelper::set_uniform_buffer(const Device& device, const uint32_t set, const uint32_t binding, Buffer& buffer, const size_t offset, const size_t range) const {
-    vkUpdateDescriptorSets(device.device, 1, tmpPtr((VkWriteDescriptorSet) {
+    _impl->write(set, (VkWriteDescriptorSet) {
         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet = _impl->get_or_create_set(set),
         .dstBinding = binding,
         .descriptorCount = 1,
         .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
@@ -204,23 +268,17 @@ void DescriptorBindHelper::set_uniform_buffer(const Device& device, const uint32
             .offset = offset,
             .range = range,
         }),
-    }), 0, nullptr);
+    });
 }
 
 void DescriptorBindHelper::commit(VkCommandBuffer cmdbuf) {
     assert(!_impl->committed);
-    for (unsigned set = 0; set < _impl->nsets; set++) {
-        if (_impl->sets[set])
-            vkCmdBindDescriptorSets(cmdbuf, _impl->bind_point, _impl->layout.pipeline_layout, set, 1, &_impl->sets[set], 0, nullptr);
-    }
+    _impl->bind(cmdbuf);
     _impl->committed = true;
 }
 
 void DescriptorBindHelper::commit_frame(const VkCommandBuffer cmdbuf) const {
-    for (unsigned set = 0; set < _impl->nsets; set++) {
-        if (_impl->sets[set])
-            vkCmdBindDescriptorSets(cmdbuf, _impl->bind_point, _impl->layout.pipeline_layout, set, 1, &_impl->sets[set], 0, nullptr);
-    }
+    _impl->bind(cmdbuf);
 }
 
 }
\ No newline at end of file
@@ -33,6 +33,78 @@ static auto make_default_device_selector(Context& context) {
     return device_selector;
 }
 
+/// Enables whichever optional features the device has, vk-bootstrap only enables a feature struct if all of its requested members are supported
+static DeviceFeatures enable_optional_features(vkb::PhysicalDevice& physical_device) {
+    DeviceFeatures features = {};
+    features.memory_budget = physical_device.enable_extension_if_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    features.memory_priority = physical_device.enable_extension_if_present(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME) && physical_device.enable_extension_features_if_present((VkPhysicalDeviceMemoryPriorityFeaturesEXT) {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT,
+        .memoryPriority = true,
+    });
+    features.push_descriptor = physical_device.enable_extension_if_present(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    features.descriptor_indexing = physical_device.enable_extension_features_if_present((VkPhysicalDeviceDescriptorIndexingFeatures) {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+        .shaderSampledImageArrayNonUniformIndexing = true,
+        .shaderStorageImageArrayNonUniformIndexing = true,
+        .descriptorBindingSampledImageUpdateAfterBind = true,
+        .descriptorBindingStorageImageUpdateAfterBind = true,
+        .descriptorBindingUpdateUnusedWhilePending = true,
+        .descriptorBindingPartiallyBound = true,
+        .runtimeDescriptorArray = true,
+    });
+    features.storage_buffer_8bit = physical_device.enable_extension_features_if_present((VkPhysicalDevice8BitStorageFeatures) {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_8BIT_STORAGE_FEATURES,
+        .storageBuffer8BitAccess = true,
+    });
+    features.storage_buffer_16bit = physical_device.enable_extension_features_if_present((VkPhysicalDevice16BitStorageFeatures) {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES,
+        .storageBuffer16BitAccess = true,
+    });
+    features.shader_int64 = physical_device.enable_features_if_present((VkPhysicalDeviceFeatures) {
+        .shaderInt64 = true,
+    });
+    features.buffer_int64_atomics = physical_device.enable_extension_features_if_present((VkPhysicalDeviceShaderAtomicInt64Features) {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_INT64_FEATURES,
+        .shaderBufferInt64Atomics = true,
+    });
+    features.external_memory_host = physical_device.enable_extension_if_present(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+    features.incremental_present = physical_device.enable_extension_if_present(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+    return features;
+}
+
+static void query_compute_capabilities(vkb::PhysicalDevice& physical_device, const VkPhysicalDeviceSubgroupSizeControlFeatures& size_control, ComputeCapabilities& caps) {
+    bool size_control_available = size_control.subgroupSizeControl || size_control.computeFullSubgroups;
+    VkPhysicalDeviceSubgroupSizeControlProperties size_control_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_SIZE_CONTROL_PROPERTIES,
+    };
+    VkPhysicalDeviceSubgroupProperties subgroup_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES,
+        .pNext = size_control_available ? &size_control_properties : nullptr,
+    };
+    VkPhysicalDeviceProperties2 properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &subgroup_properties,
+    };
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+
+    auto& limits = properties.properties.limits;
+    caps = {
+        .subgroup_size = subgroup_properties.subgroupSize,
+        .subgroup_stages = subgroup_properties.supportedStages,
+        .subgroup_operations = subgroup_properties.supportedOperations,
+        .subgroup_size_control = size_control.subgroupSizeControl == VK_TRUE,
+        .compute_full_subgroups = size_control.computeFullSubgroups == VK_TRUE,
+        .min_subgroup_size = size_control_available ? size_control_properties.minSubgroupSize : subgroup_properties.subgroupSize,
+        .max_subgroup_size = size_control_available ? size_control_properties.maxSubgroupSize : subgroup_properties.subgroupSize,
+        .required_subgroup_size_stages = size_control_available ? size_control_properties.requiredSubgroupSizeStages : 0,
+        .max_compute_workgroup_subgroups = size_control_available ? size_control_properties.maxComputeWorkgroupSubgroups : limits.maxComputeWorkGroupInvocations / subgroup_properties.subgroupSize,
+        .max_compute_shared_memory_size = limits.maxComputeSharedMemorySize,
+        .max_compute_workgroup_invocations = limits.maxComputeWorkGroupInvocations,
+        .max_compute_workgroup_size = { limits.maxComputeWorkGroupSize[0], limits.maxComputeWorkGroupSize[1], limits.maxComputeWorkGroupSize[2] },
+        .max_compute_workgroup_count = { limits.maxComputeWorkGroupCount[0], limits.maxComputeWorkGroupCount[1], limits.maxComputeWorkGroupCount[2] },
+    };
+}
+
 std::vector<vkb::PhysicalDevice> Context::available_devices(std::function<void(vkb::PhysicalDeviceSelector&)>&& f) {
     auto selector = make_default_device_selector(*this);
     f(selector);
@@ -54,7 +126,44 @@ Device::Device(Context& context, std::function<void(vkb::PhysicalDeviceSelector&
 Device::Device(imr::Context& context, vkb::PhysicalDevice physical_device) : context(context), physical_device(physical_device) {
     _impl = std::make_unique<Impl>();
 
-    if (auto built = vkb::DeviceBuilder(physical_device)
+    // core in 1.3, but we also accept 1.2 devices. Enable whichever of the two features is supported.
+    VkPhysicalDeviceSubgroupSizeControlFeatures size_control = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_SIZE_CONTROL_FEATURES,
+    };
+    if (physical_device.properties.apiVersion >= VK_API_VERSION_1_3 || this->physical_device.enable_extension_if_present(VK_EXT_SUBGROUP_SIZE_CONTROL_EXTENSION_NAME)) {
+        vkGetPhysicalDeviceFeatures2(physical_device, tmpPtr((VkPhysicalDeviceFeatures2) {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &size_control,
+        }));
+        size_control.pNext = nullptr;
+        if ((size_control.subgroupSizeControl || size_control.computeFullSubgroups) && !this->physical_device.enable_extension_features_if_present(size_control))
+            size_control = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_SIZE_CONTROL_FEATURES };
+    }
+    query_compute_capabilities(this->physical_device, size_control, _impl->compute_capabilities);
+
+    _impl->features = enable_optional_features(this->physical_device);
+    if (_impl->features.push_descriptor) {
+        VkPhysicalDevicePushDescriptorPropertiesKHR push_descriptor_properties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR,
+        };
+        vkGetPhysicalDeviceProperties2(physical_device, tmpPtr((VkPhysicalDeviceProperties2) {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &push_descriptor_properties,
+        }));
+        _impl->max_push_descriptors = push_descriptor_properties.maxPushDescriptors;
+    }
+    if (_impl->features.external_memory_host) {
+        VkPhysicalDeviceExternalMemoryHostPropertiesEXT host_properties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT,
+        };
+        vkGetPhysicalDeviceProperties2(physical_device, tmpPtr((VkPhysicalDeviceProperties2) {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &host_properties,
+        }));
+        _impl->host_import_alignment = host_properties.minImportedHostPointerAlignment;
+    }
+
+    if (auto built = vkb::DeviceBuilder(this->physical_device)
             .build(); built.has_value())
     {
         device = built.value();
@@ -64,22 +173,63 @@ Device::Device(imr::Context& context, vkb::PhysicalDevice physical_device) : con
     main_queue_idx = device.get_queue_index(vkb::QueueType((int) vkb::QueueType::graphics | (int) vkb::QueueType::present)).value();
     main_queue = device.get_queue(vkb::QueueType((int) vkb::QueueType::graphics | (int) vkb::QueueType::present)).value();
 
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, families.data());
+    uint32_t valid_bits = families[main_queue_idx].timestampValidBits;
+    _impl->timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+    auto& limits = physical_device.properties.limits;
+    _impl->has_timestamps = limits.timestampComputeAndGraphics && limits.timestampPeriod > 0 && valid_bits > 0;
+
     CHECK_VK(vkCreateCommandPool(device, tmpPtr((VkCommandPoolCreateInfo) {
         .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
         .queueFamilyIndex = main_queue_idx,
     }), nullptr, &pool), throw std::runtime_error("failed to create cmdpool"));
 
     CHECK_VK(vmaCreateAllocator(tmpPtr((VmaAllocatorCreateInfo) {
-        .flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
+        .flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT
+               | (_impl->features.memory_budget ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0)
+               | (_impl->features.memory_priority ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_PRIORITY_BIT : 0),
         .physicalDevice = physical_device,
         .device = device,
         .instance = context.instance,
     }), &_impl->allocator), throw std::runtime_error("failed to create VMA allocator"));
 }
 
+double timestamp_ms(Device& device, uint64_t begin, uint64_t end) {
+    uint64_t mask = device._impl->timestamp_mask;
+    // masking the difference as well keeps it right when the counter wrapped in between
+    return double(((end & mask) - (begin & mask)) & mask) * device.physical_device.properties.limits.timestampPeriod / 1000000.0;
+}
+
+const ComputeCapabilities& Device::compute_capabilities() const { return _impl->compute_capabilities; }
+const DeviceFeatures& Device::features() const { return _impl->features; }
+size_t Device::host_import_alignment() const { return _impl->host_import_alignment; }
+
+// without VK_EXT_memory_budget, VMA estimates the budget from the heap sizes and its own allocations
+MemoryBudget Device::device_local_memory_budget() const {
+    const VkPhysicalDeviceMemoryProperties* memory_properties;
+    vmaGetMemoryProperties(_impl->allocator, &memory_properties);
+    std::vector<VmaBudget> budgets(memory_properties->memoryHeapCount);
+    vmaGetHeapBudgets(_impl->allocator, budgets.data());
+
+    MemoryBudget total = {};
+    for (uint32_t heap = 0; heap < memory_properties->memoryHeapCount; heap++) {
+        if (memory_properties->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            total.usage += budgets[heap].usage;
+            total.budget += budgets[heap].budget;
+        }
+    }
+    return total;
+}
+
 Device::~Device() {
     vkDeviceWaitIdle(device);
 
+    for (auto& [key, sampler] : _impl->samplers)
+        vkDestroySampler(device, sampler, nullptr);
+    _impl->layouts.destroy(*this);
     vmaDestroyAllocator(_impl->allocator);
     vkDestroyCommandPool(device, pool, nullptr);
     vkb::destroy_device(device);
@@ -0,0 +1,196 @@
+#include "imr_private.h"
+
+#include "imr/util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+// generated by glslang from src/kernels/
+#include "device_benchmark.spv.h"
+
+namespace imr {
+
+/// Big enough to get past launch overheads on fast devices, small enough not to take ages on software ones
+static constexpr uint32_t benchmark_invocations = 1024 * 1024;
+static constexpr uint32_t benchmark_iterations = 64;
+/// 4 chains of vec4 FMAs
+static constexpr double benchmark_flops_per_iteration = 4 * 4 * 2;
+static constexpr size_t benchmark_transfer_size = 32 * 1024 * 1024;
+static constexpr int benchmark_runs = 3;
+
+double DeviceBenchmark::score(Workload workload) const {
+    switch (workload) {
+        case Workload::Compute: return std::sqrt(compute_gflops * copy_gbps);
+        case Workload::Transfer: return upload_gbps;
+        case Workload::Mixed: return std::cbrt(compute_gflops * copy_gbps * upload_gbps);
+    }
+    return 0;
+}
+
+static std::optional<std::filesystem::path> benchmark_cache_path() {
+    if (auto path = getenv("IMR_DEVICE_CACHE"))
+        return std::filesystem::path(path);
+    if (auto cache = getenv("XDG_CACHE_HOME"))
+        return std::filesystem::path(cache) / "imr" / "device_benchmarks";
+    if (auto home = getenv("HOME"))
+        return std::filesystem::path(home) / ".cache" / "imr" / "device_benchmarks";
+    if (auto local = getenv("LOCALAPPDATA"))
+        return std::filesystem::path(local) / "imr" / "device_benchmarks";
+    return std::nullopt;
+}
+
+/// One line per device: vendor, device and driver version, the results, then the device name for humans
+static std::string benchmark_cache_key(const vkb::PhysicalDevice& physical_device) {
+    auto& properties = physical_device.properties;
+    char key[32];
+    snprintf(key, sizeof(key), "%08x:%08x:%08x", properties.vendorID, properties.deviceID, properties.driverVersion);
+    return key;
+}
+
+static std::unordered_map<std::string, std::string> load_benchmark_cache(const std::filesystem::path& path) {
+    std::unordered_map<std::string, std::string> lines;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        auto space = line.find(' ');
+        if (space != std::string::npos)
+            lines[line.substr(0, space)] = line;
+    }
+    return lines;
+}
+
+static std::optional<DeviceBenchmark> parse_benchmark(const std::string& line) {
+    std::istringstream stream(line);
+    std::string key;
+    DeviceBenchmark benchmark;
+    if (stream >> key >> benchmark.compute_gflops >> benchmark.upload_gbps >> benchmark.copy_gbps)
+        return benchmark;
+    return std::nullopt;
+}
+
+static std::string format_benchmark(const vkb::PhysicalDevice& physical_device, const DeviceBenchmark& benchmark) {
+    std::ostringstream line;
+    line << benchmark_cache_key(physical_device) << " " << benchmark.compute_gflops << " " << benchmark.upload_gbps << " " << benchmark.copy_gbps << " " << physical_device.properties.deviceName;
+    return line.str();
+}
+
+/// Best of a few runs, after a warm-up one. Uses timestamps where the queue has them, so submission overhead doesn't count.
+static double time_ms(Device& device, VkQueryPool query_pool, std::function<void(VkCommandBuffer)> fn) {
+    bool timestamps = device._impl->has_timestamps;
+    double best = INFINITY;
+    for (int run = 0; run <= benchmark_runs; run++) {
+        auto start = imr_get_time_nano();
+        device.executeCommandsSync([&](VkCommandBuffer cmdbuf) {
+            if (timestamps) {
+                vkCmdResetQueryPool(cmdbuf, query_pool, 0, 2);
+                vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+            }
+            fn(cmdbuf);
+            if (timestamps)
+                vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 1);
+        });
+        double ms = (imr_get_time_nano() - start) / 1000000.0;
+        uint64_t ticks[2];
+        if (timestamps && vkGetQueryPoolResults(device.device, query_pool, 0, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS)
+            ms = timestamp_ms(device, ticks[0], ticks[1]);
+        if (run > 0)
+            best = std::min(best, ms);
+    }
+    // guard against timers too coarse to see anything
+    return std::max(best, 0.001);
+}
+
+static DeviceBenchmark run_benchmark(Context& context, const vkb::PhysicalDevice& physical_device) {
+    Device device(context, physical_device);
+
+    VkQueryPool query_pool;
+    CHECK_VK_THROW(vkCreateQueryPool(device.device, tmpPtr((VkQueryPoolCreateInfo) {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2,
+    }), nullptr, &query_pool));
+
+    DeviceBenchmark benchmark;
+    {
+        ComputePipeline kernel(device, embedded_spirv(imr_device_benchmark_spv));
+        Buffer results(device, benchmark_invocations * sizeof(float) * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        struct {
+            VkDeviceAddress results;
+            uint32_t iterations;
+        } push_constants = { results.device_address(), benchmark_iterations };
+
+        double ms = time_ms(device, query_pool, [&](VkCommandBuffer cmdbuf) {
+            kernel.bind(cmdbuf);
+            kernel.dispatch(cmdbuf, push_constants, { benchmark_invocations, 1, 1 });
+        });
+        benchmark.compute_gflops = benchmark_invocations * benchmark_iterations * benchmark_flops_per_iteration / (ms * 1000000.0);
+    }
+
+    {
+        Buffer host(device, benchmark_transfer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        Buffer a(device, benchmark_transfer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+        Buffer b(device, benchmark_transfer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+        auto copy = [&](Buffer& src, Buffer& dst) {
+            return time_ms(device, query_pool, [&](VkCommandBuffer cmdbuf) {
+                vkCmdCopyBuffer(cmdbuf, src.handle, dst.handle, 1, tmpPtr((VkBufferCopy) { .size = benchmark_transfer_size }));
+            });
+        };
+        benchmark.upload_gbps = benchmark_transfer_size / (copy(host, a) * 1000000.0);
+        benchmark.copy_gbps = benchmark_transfer_size / (copy(a, b) * 1000000.0);
+    }
+
+    vkDestroyQueryPool(device.device, query_pool, nullptr);
+    return benchmark;
+}
+
+std::vector<std::pair<vkb::PhysicalDevice, DeviceBenchmark>> Context::benchmark_devices(std::function<void(vkb::PhysicalDeviceSelector&)>&& device_custom) {
+    auto cache_path = benchmark_cache_path();
+    std::unordered_map<std::string, std::string> cache;
+    if (cache_path)
+        cache = load_benchmark_cache(*cache_path);
+
+    bool cache_dirty = false;
+    std::vector<std::pair<vkb::PhysicalDevice, DeviceBenchmark>> results;
+    for (auto& physical_device : available_devices(std::move(device_custom))) {
+        std::optional<DeviceBenchmark> benchmark;
+        auto key = benchmark_cache_key(physical_device);
+        if (auto found = cache.find(key); found != cache.end())
+            benchmark = parse_benchmark(found->second);
+        if (!benchmark) {
+            try {
+                benchmark = run_benchmark(*this, physical_device);
+            } catch (std::exception& e) {
+                fprintf(stderr, "Failed to benchmark %s: %s\n", physical_device.properties.deviceName, e.what());
+                continue;
+            }
+            cache[key] = format_benchmark(physical_device, *benchmark);
+            cache_dirty = true;
+        }
+        results.emplace_back(physical_device, *benchmark);
+    }
+
+    if (cache_path && cache_dirty) {
+        std::error_code error;
+        std::filesystem::create_directories(cache_path->parent_path(), error);
+        std::ofstream file(*cache_path);
+        for (auto& [key, line] : cache)
+            file << line << "\n";
+    }
+    return results;
+}
+
+vkb::PhysicalDevice Context::fastest_device(Workload workload, std::function<void(vkb::PhysicalDeviceSelector&)>&& device_custom) {
+    auto benchmarks = benchmark_devices(std::move(device_custom));
+    if (benchmarks.empty())
+        throw std::runtime_error("failed to select a device");
+    auto fastest = std::max_element(benchmarks.begin(), benchmarks.end(), [&](auto& a, auto& b) {
+        return a.second.score(workload) < b.second.score(workload);
+    });
+    return fastest->first;
+}
+
+}
@@ -0,0 +1,214 @@
+#include "imr_private.h"
+
+#include "imr/util.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace imr {
+
+/// Timings come back a few frames late, this is how many frames can be timed at once
+static constexpr uint32_t timed_frames = 4;
+/// Weight of the newest measurement in the cost average
+static constexpr double cost_smoothing = 0.1;
+/// Scale changes smaller than this are not worth the visible shift in sharpness
+static constexpr float scale_deadband = 0.02f;
+
+struct TimedFrame {
+    VkFence done;
+    VkSemaphore rendered;
+    float scale = 0;
+    bool pending = false;
+};
+
+struct DynamicResolution::Impl {
+    Swapchain& swapchain;
+    Device& device;
+    Options options;
+
+    std::unique_ptr<Image> target;
+    VkQueryPool timestamps;
+    bool has_timestamps;
+    TimedFrame frames[timed_frames];
+    size_t frame_counter = 0;
+    uint64_t last_frame_time = 0;
+
+    /// Estimated GPU time of a frame at scale 1, assuming the cost goes with the pixel count
+    double full_scale_ms = 0;
+    double frame_ms = 0;
+    float scale;
+
+    Impl(Swapchain& swapchain, Options options) : swapchain(swapchain), device(swapchain.device()), options(options) {
+        scale = options.max_scale;
+        has_timestamps = device._impl->has_timestamps;
+        CHECK_VK_THROW(vkCreateQueryPool(device.device, tmpPtr((VkQueryPoolCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = timed_frames * 2,
+        }), nullptr, &timestamps));
+        for (auto& frame : frames) {
+            CHECK_VK_THROW(vkCreateFence(device.device, tmpPtr((VkFenceCreateInfo) {
+                .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+            }), nullptr, &frame.done));
+            CHECK_VK_THROW(vkCreateSemaphore(device.device, tmpPtr((VkSemaphoreCreateInfo) {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            }), nullptr, &frame.rendered));
+        }
+    }
+
+    void ensure_target(VkExtent2D swapchain_extent) {
+        VkExtent3D size = {
+            std::max(1u, uint32_t(std::ceil(swapchain_extent.width * options.max_scale))),
+            std::max(1u, uint32_t(std::ceil(swapchain_extent.height * options.max_scale))),
+            1
+        };
+        if (target && target->size().width == size.width && target->size().height == size.height)
+            return;
+        // only happens when the window is resized
+        swapchain.drain();
+        target = std::make_unique<Image>(device, VK_IMAGE_TYPE_2D, size, options.format, static_cast<VkImageUsageFlagBits>(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+    }
+
+    void measured(double ms, float at_scale) {
+        frame_ms = frame_ms == 0 ? ms : frame_ms + (ms - frame_ms) * cost_smoothing;
+        double cost = ms / (double(at_scale) * at_scale);
+        full_scale_ms = full_scale_ms == 0 ? cost : full_scale_ms + (cost - full_scale_ms) * cost_smoothing;
+
+        float desired = std::clamp(float(std::sqrt(options.target_frame_ms / full_scale_ms)), options.min_scale, options.max_scale);
+        if (std::abs(desired - scale) > scale_deadband || desired == options.min_scale || desired == options.max_scale)
+            scale = desired;
+    }
+
+    /// Waits until `frame` can be reused, and feeds its timing to the controller
+    void retire(uint32_t index) {
+        auto& frame = frames[index];
+        CHECK_VK_THROW(vkWaitForFences(device.device, 1, &frame.done, true, UINT64_MAX));
+        if (!frame.pending)
+            return;
+        frame.pending = false;
+        uint64_t ticks[2];
+        if (has_timestamps && vkGetQueryPoolResults(device.device, timestamps, index * 2, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+            measured(timestamp_ms(device, ticks[0], ticks[1]), frame.scale);
+    }
+
+    ~Impl() {
+        for (uint32_t i = 0; i < timed_frames; i++)
+            retire(i);
+        for (auto& frame : frames) {
+            vkDestroyFence(device.device, frame.done, nullptr);
+            vkDestroySemaphore(device.device, frame.rendered, nullptr);
+        }
+        vkDestroyQueryPool(device.device, timestamps, nullptr);
+    }
+};
+
+DynamicResolution::DynamicResolution(Swapchain& swapchain, Options options) {
+    assert(options.min_scale > 0 && options.min_scale <= options.max_scale);
+    _impl = std::make_unique<Impl>(swapchain, options);
+}
+
+DynamicResolution::~DynamicResolution() {
+    _impl->swapchain.drain();
+}
+
+float DynamicResolution::scale() const { return _impl->scale; }
+double DynamicResolution::gpu_frame_time() const { return _impl->frame_ms; }
+
+void DynamicResolution::renderFrame(std::function<void(RenderContext&)>&& fn) {
+    auto& device = _impl->device;
+    auto& vk = device.dispatch;
+
+    _impl->swapchain.beginFrame([&](Swapchain::Frame& frame) {
+        uint32_t index = _impl->frame_counter++ % timed_frames;
+        _impl->retire(index);
+        auto& timed = _impl->frames[index];
+
+        // without timestamps, the time between frames will have to do
+        uint64_t now = imr_get_time_nano();
+        if (!_impl->has_timestamps && _impl->last_frame_time != 0)
+            _impl->measured(double(now - _impl->last_frame_time) / 1000000.0, _impl->scale);
+        _impl->last_frame_time = now;
+
+        VkExtent3D extent = frame.image().size();
+        _impl->ensure_target({ extent.width, extent.height });
+        auto& target = *_impl->target;
+        VkExtent2D render_size = {
+            std::clamp(uint32_t(std::round(extent.width * _impl->scale)), 1u, target.size().width),
+            std::clamp(uint32_t(std::round(extent.height * _impl->scale)), 1u, target.size().height),
+        };
+
+        VkCommandBuffer cmdbuf;
+        CHECK_VK_THROW(vkAllocateCommandBuffers(device.device, tmpPtr((VkCommandBufferAllocateInfo) {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = device.pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        }), &cmdbuf));
+        CHECK_VK_THROW(vkBeginCommandBuffer(cmdbuf, tmpPtr((VkCommandBufferBeginInfo) {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        })));
+
+        if (_impl->has_timestamps)
+            vkCmdResetQueryPool(cmdbuf, _impl->timestamps, index * 2, 2);
+        // every frame renders into the same target: wait for whatever earlier submissions were still doing with it, typically the previous upscale
+        vk.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .imageMemoryBarrierCount = 1,
+            .pImageMemoryBarriers = tmpPtr((VkImageMemoryBarrier2) {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                .srcAccessMask = VK_ACCESS_2_NONE,
+                .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+                .image = target.handle(),
+                .subresourceRange = target.whole_image_subresource_range(),
+            }),
+        }));
+        if (_impl->has_timestamps)
+            vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _impl->timestamps, index * 2);
+
+        RenderContext context { cmdbuf, target, render_size, frame };
+        fn(context);
+
+        if (_impl->has_timestamps)
+            vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _impl->timestamps, index * 2 + 1);
+        vk.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = tmpPtr((VkMemoryBarrier2) {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                .srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+            }),
+        }));
+        CHECK_VK_THROW(vkEndCommandBuffer(cmdbuf));
+
+        CHECK_VK_THROW(vkResetFences(device.device, 1, &timed.done));
+        CHECK_VK_THROW(device.enqueueSubmit((VkSubmitInfo) {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &cmdbuf,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &timed.rendered,
+        }, VK_NULL_HANDLE));
+        timed.scale = _impl->scale;
+        timed.pending = true;
+
+        frame.addCleanupAction([=, &device]() {
+            vkFreeCommandBuffers(device.device, device.pool, 1, &cmdbuf);
+        });
+        // upscales from the rendered corner to the whole swapchain image, and signals once the semaphore and target can be reused
+        if (_impl->options.edge_aware_upscale)
+            frame.presentUpscaled(target, timed.done, timed.rendered, render_size, _impl->options.sharpness_stops);
+        else
+            frame.presentFromImage(target.handle(), timed.done, timed.rendered, VK_IMAGE_LAYOUT_GENERAL, render_size);
+    });
+}
+
+}
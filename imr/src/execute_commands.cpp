@@ -24,7 +24,7 @@ void Device::executeCommandsSync(std::function<void(VkCommandBuffer)> lambda) {
     }), nullptr, &fence);
 
     vkEndCommandBuffer(cmdbuf);
-    vkQueueSubmit(main_queue, 1, tmpPtr((VkSubmitInfo) {
+    submit((VkSubmitInfo) {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
         .waitSemaphoreCount = 0,
         .pWaitSemaphores = nullptr,
@@ -33,7 +33,7 @@ void Device::executeCommandsSync(std::function<void(VkCommandBuffer)> lambda) {
         .pCommandBuffers = &cmdbuf,
         .signalSemaphoreCount = 0,
         .pSignalSemaphores = nullptr,
-    }), fence);
+    }, fence);
 
     vkWaitForFences(device, 1, &fence, true, UINT64_MAX);
 
@@ -0,0 +1,371 @@
+#include "imr_private.h"
+
+#include <array>
+
+namespace imr {
+
+using enum FormatNumericType;
+
+static constexpr FormatInfo color(uint8_t bytes, uint8_t channels, FormatNumericType type, bool srgb = false) {
+    return FormatInfo { VK_IMAGE_ASPECT_COLOR_BIT, bytes, 1, 1, channels, srgb, type };
+}
+
+static constexpr FormatInfo block(uint8_t bytes, uint8_t width, uint8_t height, uint8_t channels, FormatNumericType type, bool srgb = false) {
+    return FormatInfo { VK_IMAGE_ASPECT_COLOR_BIT, bytes, width, height, channels, srgb, type };
+}
+
+static constexpr FormatInfo depth_stencil(VkImageAspectFlags aspects, uint8_t bytes, uint8_t channels, FormatNumericType type) {
+    return FormatInfo { aspects, bytes, 1, 1, channels, false, type };
+}
+
+/// Multi-planar formats have no single texel size, the planes have to be addressed individually
+static constexpr FormatInfo multi_planar(uint8_t channels) {
+    return FormatInfo { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 1, channels, false, UNorm };
+}
+
+/// Indexed directly by VkFormat, covers every core format up to the last one from Vulkan 1.0
+static constexpr auto core_formats = []() {
+    std::array<FormatInfo, VK_FORMAT_ASTC_12x12_SRGB_BLOCK + 1> t {};
+    t[VK_FORMAT_R4G4_UNORM_PACK8] = color(1, 2, UNorm);
+    t[VK_FORMAT_R4G4B4A4_UNORM_PACK16] = color(2, 4, UNorm);
+    t[VK_FORMAT_B4G4R4A4_UNORM_PACK16] = color(2, 4, UNorm);
+    t[VK_FORMAT_R5G6B5_UNORM_PACK16] = color(2, 3, UNorm);
+    t[VK_FORMAT_B5G6R5_UNORM_PACK16] = color(2, 3, UNorm);
+    t[VK_FORMAT_R5G5B5A1_UNORM_PACK16] = color(2, 4, UNorm);
+    t[VK_FORMAT_B5G5R5A1_UNORM_PACK16] = color(2, 4, UNorm);
+    t[VK_FORMAT_A1R5G5B5_UNORM_PACK16] = color(2, 4, UNorm);
+
+    t[VK_FORMAT_R8_UNORM] = color(1, 1, UNorm);
+    t[VK_FORMAT_R8_SNORM] = color(1, 1, SNorm);
+    t[VK_FORMAT_R8_USCALED] = color(1, 1, UScaled);
+    t[VK_FORMAT_R8_SSCALED] = color(1, 1, SScaled);
+    t[VK_FORMAT_R8_UINT] = color(1, 1, UInt);
+    t[VK_FORMAT_R8_SINT] = color(1, 1, SInt);
+    t[VK_FORMAT_R8_SRGB] = color(1, 1, UNorm, true);
+    t[VK_FORMAT_R8G8_UNORM] = color(2, 2, UNorm);
+    t[VK_FORMAT_R8G8_SNORM] = color(2, 2, SNorm);
+    t[VK_FORMAT_R8G8_USCALED] = color(2, 2, UScaled);
+    t[VK_FORMAT_R8G8_SSCALED] = color(2, 2, SScaled);
+    t[VK_FORMAT_R8G8_UINT] = color(2, 2, UInt);
+    t[VK_FORMAT_R8G8_SINT] = color(2, 2, SInt);
+    t[VK_FORMAT_R8G8_SRGB] = color(2, 2, UNorm, true);
+    t[VK_FORMAT_R8G8B8_UNORM] = color(3, 3, UNorm);
+    t[VK_FORMAT_R8G8B8_SNORM] = color(3, 3, SNorm);
+    t[VK_FORMAT_R8G8B8_USCALED] = color(3, 3, UScaled);
+    t[VK_FORMAT_R8G8B8_SSCALED] = color(3, 3, SScaled);
+    t[VK_FORMAT_R8G8B8_UINT] = color(3, 3, UInt);
+    t[VK_FORMAT_R8G8B8_SINT] = color(3, 3, SInt);
+    t[VK_FORMAT_R8G8B8_SRGB] = color(3, 3, UNorm, true);
+    t[VK_FORMAT_B8G8R8_UNORM] = color(3, 3, UNorm);
+    t[VK_FORMAT_B8G8R8_SNORM] = color(3, 3, SNorm);
+    t[VK_FORMAT_B8G8R8_USCALED] = color(3, 3, UScaled);
+    t[VK_FORMAT_B8G8R8_SSCALED] = color(3, 3, SScaled);
+    t[VK_FORMAT_B8G8R8_UINT] = color(3, 3, UInt);
+    t[VK_FORMAT_B8G8R8_SINT] = color(3, 3, SInt);
+    t[VK_FORMAT_B8G8R8_SRGB] = color(3, 3, UNorm, true);
+    t[VK_FORMAT_R8G8B8A8_UNORM] = color(4, 4, UNorm);
+    t[VK_FORMAT_R8G8B8A8_SNORM] = color(4, 4, SNorm);
+    t[VK_FORMAT_R8G8B8A8_USCALED] = color(4, 4, UScaled);
+    t[VK_FORMAT_R8G8B8A8_SSCALED] = color(4, 4, SScaled);
+    t[VK_FORMAT_R8G8B8A8_UINT] = color(4, 4, UInt);
+    t[VK_FORMAT_R8G8B8A8_SINT] = color(4, 4, SInt);
+    t[VK_FORMAT_R8G8B8A8_SRGB] = color(4, 4, UNorm, true);
+    t[VK_FORMAT_B8G8R8A8_UNORM] = color(4, 4, UNorm);
+    t[VK_FORMAT_B8G8R8A8_SNORM] = color(4, 4, SNorm);
+    t[VK_FORMAT_B8G8R8A8_USCALED] = color(4, 4, UScaled);
+    t[VK_FORMAT_B8G8R8A8_SSCALED] = color(4, 4, SScaled);
+    t[VK_FORMAT_B8G8R8A8_UINT] = color(4, 4, UInt);
+    t[VK_FORMAT_B8G8R8A8_SINT] = color(4, 4, SInt);
+    t[VK_FORMAT_B8G8R8A8_SRGB] = color(4, 4, UNorm, true);
+    t[VK_FORMAT_A8B8G8R8_UNORM_PACK32] = color(4, 4, UNorm);
+    t[VK_FORMAT_A8B8G8R8_SNORM_PACK32] = color(4, 4, SNorm);
+    t[VK_FORMAT_A8B8G8R8_USCALED_PACK32] = color(4, 4, UScaled);
+    t[VK_FORMAT_A8B8G8R8_SSCALED_PACK32] = color(4, 4, SScaled);
+    t[VK_FORMAT_A8B8G8R8_UINT_PACK32] = color(4, 4, UInt);
+    t[VK_FORMAT_A8B8G8R8_SINT_PACK32] = color(4, 4, SInt);
+    t[VK_FORMAT_A8B8G8R8_SRGB_PACK32] = color(4, 4, UNorm, true);
+
+    t[VK_FORMAT_A2R10G10B10_UNORM_PACK32] = color(4, 4, UNorm);
+    t[VK_FORMAT_A2R10G10B10_SNORM_PACK32] = color(4, 4, SNorm);
+    t[VK_FORMAT_A2R10G10B10_USCALED_PACK32] = color(4, 4, UScaled);
+    t[VK_FORMAT_A2R10G10B10_SSCALED_PACK32] = color(4, 4, SScaled);
+    t[VK_FORMAT_A2R10G10B10_UINT_PACK32] = color(4, 4, UInt);
+    t[VK_FORMAT_A2R10G10B10_SINT_PACK32] = color(4, 4, SInt);
+    t[VK_FORMAT_A2B10G10R10_UNORM_PACK32] = color(4, 4, UNorm);
+    t[VK_FORMAT_A2B10G10R10_SNORM_PACK32] = color(4, 4, SNorm);
+    t[VK_FORMAT_A2B10G10R10_USCALED_PACK32] = color(4, 4, UScaled);
+    t[VK_FORMAT_A2B10G10R10_SSCALED_PACK32] = color(4, 4, SScaled);
+    t[VK_FORMAT_A2B10G10R10_UINT_PACK32] = color(4, 4, UInt);
+    t[VK_FORMAT_A2B10G10R10_SINT_PACK32] = color(4, 4, SInt);
+
+    t[VK_FORMAT_R16_UNORM] = color(2, 1, UNorm);
+    t[VK_FORMAT_R16_SNORM] = color(2, 1, SNorm);
+    t[VK_FORMAT_R16_USCALED] = color(2, 1, UScaled);
+    t[VK_FORMAT_R16_SSCALED] = color(2, 1, SScaled);
+    t[VK_FORMAT_R16_UINT] = color(2, 1, UInt);
+    t[VK_FORMAT_R16_SINT] = color(2, 1, SInt);
+    t[VK_FORMAT_R16_SFLOAT] = color(2, 1, SFloat);
+    t[VK_FORMAT_R16G16_UNORM] = color(4, 2, UNorm);
+    t[VK_FORMAT_R16G16_SNORM] = color(4, 2, SNorm);
+    t[VK_FORMAT_R16G16_USCALED] = color(4, 2, UScaled);
+    t[VK_FORMAT_R16G16_SSCALED] = color(4, 2, SScaled);
+    t[VK_FORMAT_R16G16_UINT] = color(4, 2, UInt);
+    t[VK_FORMAT_R16G16_SINT] = color(4, 2, SInt);
+    t[VK_FORMAT_R16G16_SFLOAT] = color(4, 2, SFloat);
+    t[VK_FORMAT_R16G16B16_UNORM] = color(6, 3, UNorm);
+    t[VK_FORMAT_R16G16B16_SNORM] = color(6, 3, SNorm);
+    t[VK_FORMAT_R16G16B16_USCALED] = color(6, 3, UScaled);
+    t[VK_FORMAT_R16G16B16_SSCALED] = color(6, 3, SScaled);
+    t[VK_FORMAT_R16G16B16_UINT] = color(6, 3, UInt);
+    t[VK_FORMAT_R16G16B16_SINT] = color(6, 3, SInt);
+    t[VK_FORMAT_R16G16B16_SFLOAT] = color(6, 3, SFloat);
+    t[VK_FORMAT_R16G16B16A16_UNORM] = color(8, 4, UNorm);
+    t[VK_FORMAT_R16G16B16A16_SNORM] = color(8, 4, SNorm);
+    t[VK_FORMAT_R16G16B16A16_USCALED] = color(8, 4, UScaled);
+    t[VK_FORMAT_R16G16B16A16_SSCALED] = color(8, 4, SScaled);
+    t[VK_FORMAT_R16G16B16A16_UINT] = color(8, 4, UInt);
+    t[VK_FORMAT_R16G16B16A16_SINT] = color(8, 4, SInt);
+    t[VK_FORMAT_R16G16B16A16_SFLOAT] = color(8, 4, SFloat);
+
+    t[VK_FORMAT_R32_UINT] = color(4, 1, UInt);
+    t[VK_FORMAT_R32_SINT] = color(4, 1, SInt);
+    t[VK_FORMAT_R32_SFLOAT] = color(4, 1, SFloat);
+    t[VK_FORMAT_R32G32_UINT] = color(8, 2, UInt);
+    t[VK_FORMAT_R32G32_SINT] = color(8, 2, SInt);
+    t[VK_FORMAT_R32G32_SFLOAT] = color(8, 2, SFloat);
+    t[VK_FORMAT_R32G32B32_UINT] = color(12, 3, UInt);
+    t[VK_FORMAT_R32G32B32_SINT] = color(12, 3, SInt);
+    t[VK_FORMAT_R32G32B32_SFLOAT] = color(12, 3, SFloat);
+    t[VK_FORMAT_R32G32B32A32_UINT] = color(16, 4, UInt);
+    t[VK_FORMAT_R32G32B32A32_SINT] = color(16, 4, SInt);
+    t[VK_FORMAT_R32G32B32A32_SFLOAT] = color(16, 4, SFloat);
+    t[VK_FORMAT_R64_UINT] = color(8, 1, UInt);
+    t[VK_FORMAT_R64_SINT] = color(8, 1, SInt);
+    t[VK_FORMAT_R64_SFLOAT] = color(8, 1, SFloat);
+    t[VK_FORMAT_R64G64_UINT] = color(16, 2, UInt);
+    t[VK_FORMAT_R64G64_SINT] = color(16, 2, SInt);
+    t[VK_FORMAT_R64G64_SFLOAT] = color(16, 2, SFloat);
+    t[VK_FORMAT_R64G64B64_UINT] = color(24, 3, UInt);
+    t[VK_FORMAT_R64G64B64_SINT] = color(24, 3, SInt);
+    t[VK_FORMAT_R64G64B64_SFLOAT] = color(24, 3, SFloat);
+    t[VK_FORMAT_R64G64B64A64_UINT] = color(32, 4, UInt);
+    t[VK_FORMAT_R64G64B64A64_SINT] = color(32, 4, SInt);
+    t[VK_FORMAT_R64G64B64A64_SFLOAT] = color(32, 4, SFloat);
+    t[VK_FORMAT_B10G11R11_UFLOAT_PACK32] = color(4, 3, UFloat);
+    t[VK_FORMAT_E5B9G9R9_UFLOAT_PACK32] = color(4, 3, UFloat);
+
+    t[VK_FORMAT_D16_UNORM] = depth_stencil(VK_IMAGE_ASPECT_DEPTH_BIT, 2, 1, UNorm);
+    t[VK_FORMAT_X8_D24_UNORM_PACK32] = depth_stencil(VK_IMAGE_ASPECT_DEPTH_BIT, 4, 1, UNorm);
+    t[VK_FORMAT_D32_SFLOAT] = depth_stencil(VK_IMAGE_ASPECT_DEPTH_BIT, 4, 1, SFloat);
+    t[VK_FORMAT_S8_UINT] = depth_stencil(VK_IMAGE_ASPECT_STENCIL_BIT, 1, 1, UInt);
+    t[VK_FORMAT_D16_UNORM_S8_UINT] = depth_stencil(VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, 3, 2, Mixed);
+    t[VK_FORMAT_D24_UNORM_S8_UINT] = depth_stencil(VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, 4, 2, Mixed);
+    t[VK_FORMAT_D32_SFLOAT_S8_UINT] = depth_stencil(VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, 5, 2, Mixed);
+
+    t[VK_FORMAT_BC1_RGB_UNORM_BLOCK] = block(8, 4, 4, 3, UNorm);
+    t[VK_FORMAT_BC1_RGB_SRGB_BLOCK] = block(8, 4, 4, 3, UNorm, true);
+    t[VK_FORMAT_BC1_RGBA_UNORM_BLOCK] = block(8, 4, 4, 4, UNorm);
+    t[VK_FORMAT_BC1_RGBA_SRGB_BLOCK] = block(8, 4, 4, 4, UNorm, true);
+    t[VK_FORMAT_BC2_UNORM_BLOCK] = block(16, 4, 4, 4, UNorm);
+    t[VK_FORMAT_BC2_SRGB_BLOCK] = block(16, 4, 4, 4, UNorm, true);
+    t[VK_FORMAT_BC3_UNORM_BLOCK] = block(16, 4, 4, 4, UNorm);
+    t[VK_FORMAT_BC3_SRGB_BLOCK] = block(16, 4, 4, 4, UNorm, true);
+    t[VK_FORMAT_BC4_UNORM_BLOCK] = block(8, 4, 4, 1, UNorm);
+    t[VK_FORMAT_BC4_SNORM_BLOCK] = block(8, 4, 4, 1, SNorm);
+    t[VK_FORMAT_BC5_UNORM_BLOCK] = block(16, 4, 4, 2, UNorm);
+    t[VK_FORMAT_BC5_SNORM_BLOCK] = block(16, 4, 4, 2, SNorm);
+    t[VK_FORMAT_BC6H_UFLOAT_BLOCK] = block(16, 4, 4, 3, UFloat);
+    t[VK_FORMAT_BC6H_SFLOAT_BLOCK] = block(16, 4, 4, 3, SFloat);
+    t[VK_FORMAT_BC7_UNORM_BLOCK] = block(16, 4, 4, 4, UNorm);
+    t[VK_FORMAT_BC7_SRGB_BLOCK] = block(16, 4, 4, 4, UNorm, true);
+    t[VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK] = block(8, 4, 4, 3, UNorm);
+    t[VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK] = block(8, 4, 4, 3, UNorm, true);
+    t[VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK] = block(8, 4, 4, 4, UNorm);
+    t[VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK] = block(8, 4, 4, 4, UNorm, true);
+    t[VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK] = block(16, 4, 4, 4, UNorm);
+    t[VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK] = block(16, 4, 4, 4, UNorm, true);
+    t[VK_FORMAT_EAC_R11_UNORM_BLOCK] = block(8, 4, 4, 1, UNorm);
+    t[VK_FORMAT_EAC_R11_SNORM_BLOCK] = block(8, 4, 4, 1, SNorm);
+    t[VK_FORMAT_EAC_R11G11_UNORM_BLOCK] = block(16, 4, 4, 2, UNorm);
+    t[VK_FORMAT_EAC_R11G11_SNORM_BLOCK] = block(16, 4, 4, 2, SNorm);
+    t[VK_FORMAT_ASTC_4x4_UNORM_BLOCK] = block(16, 4, 4, 4, UNorm);
+    t[VK_FORMAT_ASTC_4x4_SRGB_BLOCK] = block(16, 4, 4, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_5x4_UNORM_BLOCK] = block(16, 5, 4, 4, UNorm);
+    t[VK_FORMAT_ASTC_5x4_SRGB_BLOCK] = block(16, 5, 4, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_5x5_UNORM_BLOCK] = block(16, 5, 5, 4, UNorm);
+    t[VK_FORMAT_ASTC_5x5_SRGB_BLOCK] = block(16, 5, 5, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_6x5_UNORM_BLOCK] = block(16, 6, 5, 4, UNorm);
+    t[VK_FORMAT_ASTC_6x5_SRGB_BLOCK] = block(16, 6, 5, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_6x6_UNORM_BLOCK] = block(16, 6, 6, 4, UNorm);
+    t[VK_FORMAT_ASTC_6x6_SRGB_BLOCK] = block(16, 6, 6, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_8x5_UNORM_BLOCK] = block(16, 8, 5, 4, UNorm);
+    t[VK_FORMAT_ASTC_8x5_SRGB_BLOCK] = block(16, 8, 5, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_8x6_UNORM_BLOCK] = block(16, 8, 6, 4, UNorm);
+    t[VK_FORMAT_ASTC_8x6_SRGB_BLOCK] = block(16, 8, 6, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_8x8_UNORM_BLOCK] = block(16, 8, 8, 4, UNorm);
+    t[VK_FORMAT_ASTC_8x8_SRGB_BLOCK] = block(16, 8, 8, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_10x5_UNORM_BLOCK] = block(16, 10, 5, 4, UNorm);
+    t[VK_FORMAT_ASTC_10x5_SRGB_BLOCK] = block(16, 10, 5, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_10x6_UNORM_BLOCK] = block(16, 10, 6, 4, UNorm);
+    t[VK_FORMAT_ASTC_10x6_SRGB_BLOCK] = block(16, 10, 6, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_10x8_UNORM_BLOCK] = block(16, 10, 8, 4, UNorm);
+    t[VK_FORMAT_ASTC_10x8_SRGB_BLOCK] = block(16, 10, 8, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_10x10_UNORM_BLOCK] = block(16, 10, 10, 4, UNorm);
+    t[VK_FORMAT_ASTC_10x10_SRGB_BLOCK] = block(16, 10, 10, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_12x10_UNORM_BLOCK] = block(16, 12, 10, 4, UNorm);
+    t[VK_FORMAT_ASTC_12x10_SRGB_BLOCK] = block(16, 12, 10, 4, UNorm, true);
+    t[VK_FORMAT_ASTC_12x12_UNORM_BLOCK] = block(16, 12, 12, 4, UNorm);
+    t[VK_FORMAT_ASTC_12x12_SRGB_BLOCK] = block(16, 12, 12, 4, UNorm, true);
+    return t;
+}();
+
+/// Formats added by extensions live in sparse enum ranges, each gets its own dense table
+static constexpr auto ycbcr_formats = []() {
+    constexpr auto base = VK_FORMAT_G8B8G8R8_422_UNORM;
+    std::array<FormatInfo, VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM - base + 1> t {};
+    t[VK_FORMAT_G8B8G8R8_422_UNORM - base] = block(4, 2, 1, 4, UNorm);
+    t[VK_FORMAT_B8G8R8G8_422_UNORM - base] = block(4, 2, 1, 4, UNorm);
+    t[VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM - base] = multi_planar(3);
+    t[VK_FORMAT_G8_B8R8_2PLANE_420_UNORM - base] = multi_planar(3);
+    t[VK_FORMAT_G8_B8_R8_3PLANE_422_UNORM - base] = multi_planar(3);
+    t[VK_FORMAT_G8_B8R8_2PLANE_422_UNORM - base] = multi_planar(3);
+    t[VK_FORMAT_G8_B8_R8_3PLANE_444_UNORM - base] = multi_planar(3);
+    t[VK_FORMAT_R10X6_UNORM_PACK16 - base] = color(2, 1, UNorm);
+    t[VK_FORMAT_R10X6G10X6_UNORM_2PACK16 - base] = color(4, 2, UNorm);
+    t[VK_FORMAT_R10X6G10X6B10X6A10X6_UNORM_4PACK16 - base] = color(8, 4, UNorm);
+    t[VK_FORMAT_G10X6B10X6G10X6R10X6_422_UNORM_4PACK16 - base] = block(8, 2, 1, 4, UNorm);
+    t[VK_FORMAT_B10X6G10X6R10X6G10X6_422_UNORM_4PACK16 - base] = block(8, 2, 1, 4, UNorm);
+    t[VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_420_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_422_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_G10X6_B10X6R10X6_2PLANE_422_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_444_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_R12X4_UNORM_PACK16 - base] = color(2, 1, UNorm);
+    t[VK_FORMAT_R12X4G12X4_UNORM_2PACK16 - base] = color(4, 2, UNorm);
+    t[VK_FORMAT_R12X4G12X4B12X4A12X4_UNORM_4PACK16 - base] = color(8, 4, UNorm);
+    t[VK_FORMAT_G12X4B12X4G12X4R12X4_422_UNORM_4PACK16 - base] = block(8, 2, 1, 4, UNorm);
+    t[VK_FORMAT_B12X4G12X4R12X4G12X4_422_UNORM_4PACK16 - base] = block(8, 2, 1, 4, UNorm);
+    t[VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_420_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_G12X4_B12X4R12X4_2PLANE_420_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_422_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_G12X4_B12X4R12X4_2PLANE_422_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_444_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_G16B16G16R16_422_UNORM - base] = block(8, 2, 1, 4, UNorm);
+    t[VK_FORMAT_B16G16R16G16_422_UNORM - base] = block(8, 2, 1, 4, UNorm);
+    t[VK_FORMAT_G16_B16_R16_3PLANE_420_UNORM - base] = multi_planar(3);
+    t[VK_FORMAT_G16_B16R16_2PLANE_420_UNORM - base] = multi_planar(3);
+    t[VK_FORMAT_G16_B16_R16_3PLANE_422_UNORM - base] = multi_planar(3);
+    t[VK_FORMAT_G16_B16R16_2PLANE_422_UNORM - base] = multi_planar(3);
+    t[VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM - base] = multi_planar(3);
+    return t;
+}();
+
+static constexpr auto ycbcr_444_2plane_formats = []() {
+    constexpr auto base = VK_FORMAT_G8_B8R8_2PLANE_444_UNORM;
+    std::array<FormatInfo, VK_FORMAT_G16_B16R16_2PLANE_444_UNORM - base + 1> t {};
+    t[VK_FORMAT_G8_B8R8_2PLANE_444_UNORM - base] = multi_planar(3);
+    t[VK_FORMAT_G10X6_B10X6R10X6_2PLANE_444_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_G12X4_B12X4R12X4_2PLANE_444_UNORM_3PACK16 - base] = multi_planar(3);
+    t[VK_FORMAT_G16_B16R16_2PLANE_444_UNORM - base] = multi_planar(3);
+    return t;
+}();
+
+static constexpr auto packed_4444_formats = []() {
+    constexpr auto base = VK_FORMAT_A4R4G4B4_UNORM_PACK16;
+    std::array<FormatInfo, VK_FORMAT_A4B4G4R4_UNORM_PACK16 - base + 1> t {};
+    t[VK_FORMAT_A4R4G4B4_UNORM_PACK16 - base] = color(2, 4, UNorm);
+    t[VK_FORMAT_A4B4G4R4_UNORM_PACK16 - base] = color(2, 4, UNorm);
+    return t;
+}();
+
+static constexpr auto astc_hdr_formats = []() {
+    constexpr auto base = VK_FORMAT_ASTC_4x4_SFLOAT_BLOCK;
+    std::array<FormatInfo, VK_FORMAT_ASTC_12x12_SFLOAT_BLOCK - base + 1> t {};
+    t[VK_FORMAT_ASTC_4x4_SFLOAT_BLOCK - base] = block(16, 4, 4, 4, SFloat);
+    t[VK_FORMAT_ASTC_5x4_SFLOAT_BLOCK - base] = block(16, 5, 4, 4, SFloat);
+    t[VK_FORMAT_ASTC_5x5_SFLOAT_BLOCK - base] = block(16, 5, 5, 4, SFloat);
+    t[VK_FORMAT_ASTC_6x5_SFLOAT_BLOCK - base] = block(16, 6, 5, 4, SFloat);
+    t[VK_FORMAT_ASTC_6x6_SFLOAT_BLOCK - base] = block(16, 6, 6, 4, SFloat);
+    t[VK_FORMAT_ASTC_8x5_SFLOAT_BLOCK - base] = block(16, 8, 5, 4, SFloat);
+    t[VK_FORMAT_ASTC_8x6_SFLOAT_BLOCK - base] = block(16, 8, 6, 4, SFloat);
+    t[VK_FORMAT_ASTC_8x8_SFLOAT_BLOCK - base] = block(16, 8, 8, 4, SFloat);
+    t[VK_FORMAT_ASTC_10x5_SFLOAT_BLOCK - base] = block(16, 10, 5, 4, SFloat);
+    t[VK_FORMAT_ASTC_10x6_SFLOAT_BLOCK - base] = block(16, 10, 6, 4, SFloat);
+    t[VK_FORMAT_ASTC_10x8_SFLOAT_BLOCK - base] = block(16, 10, 8, 4, SFloat);
+    t[VK_FORMAT_ASTC_10x10_SFLOAT_BLOCK - base] = block(16, 10, 10, 4, SFloat);
+    t[VK_FORMAT_ASTC_12x10_SFLOAT_BLOCK - base] = block(16, 12, 10, 4, SFloat);
+    t[VK_FORMAT_ASTC_12x12_SFLOAT_BLOCK - base] = block(16, 12, 12, 4, SFloat);
+    return t;
+}();
+
+static constexpr auto pvrtc_formats = []() {
+    constexpr auto base = VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG;
+    std::array<FormatInfo, VK_FORMAT_PVRTC2_4BPP_SRGB_BLOCK_IMG - base + 1> t {};
+    t[VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG - base] = block(8, 8, 4, 4, UNorm);
+    t[VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG - base] = block(8, 4, 4, 4, UNorm);
+    t[VK_FORMAT_PVRTC2_2BPP_UNORM_BLOCK_IMG - base] = block(8, 8, 4, 4, UNorm);
+    t[VK_FORMAT_PVRTC2_4BPP_UNORM_BLOCK_IMG - base] = block(8, 4, 4, 4, UNorm);
+    t[VK_FORMAT_PVRTC1_2BPP_SRGB_BLOCK_IMG - base] = block(8, 8, 4, 4, UNorm, true);
+    t[VK_FORMAT_PVRTC1_4BPP_SRGB_BLOCK_IMG - base] = block(8, 4, 4, 4, UNorm, true);
+    t[VK_FORMAT_PVRTC2_2BPP_SRGB_BLOCK_IMG - base] = block(8, 8, 4, 4, UNorm, true);
+    t[VK_FORMAT_PVRTC2_4BPP_SRGB_BLOCK_IMG - base] = block(8, 4, 4, 4, UNorm, true);
+    return t;
+}();
+
+static constexpr auto maintenance5_formats = []() {
+    constexpr auto base = VK_FORMAT_A1B5G5R5_UNORM_PACK16_KHR;
+    std::array<FormatInfo, VK_FORMAT_A8_UNORM_KHR - base + 1> t {};
+    t[VK_FORMAT_A1B5G5R5_UNORM_PACK16_KHR - base] = color(2, 4, UNorm);
+    t[VK_FORMAT_A8_UNORM_KHR - base] = color(1, 1, UNorm);
+    return t;
+}();
+
+static constexpr FormatInfo r16g16_s10_5_nv = color(4, 2, SInt);
+
+static_assert(core_formats[VK_FORMAT_R8G8B8A8_UNORM].block_size == 4);
+static_assert(core_formats[VK_FORMAT_D32_SFLOAT].aspects == VK_IMAGE_ASPECT_DEPTH_BIT);
+static_assert(core_formats[VK_FORMAT_BC7_SRGB_BLOCK].srgb);
+
+template<size_t N>
+static const FormatInfo* lookup_range(const std::array<FormatInfo, N>& table, VkFormat base, VkFormat format) {
+    if (format < base || static_cast<size_t>(format - base) >= N)
+        return nullptr;
+    return &table[format - base];
+}
+
+const FormatInfo& format_info(VkFormat format) {
+    if (format == VK_FORMAT_UNDEFINED)
+        throw std::runtime_error("Not a valid format");
+
+    const FormatInfo* found = nullptr;
+    if (static_cast<size_t>(format) < core_formats.size())
+        found = &core_formats[format];
+    if (!found)
+        found = lookup_range(ycbcr_formats, VK_FORMAT_G8B8G8R8_422_UNORM, format);
+    if (!found)
+        found = lookup_range(ycbcr_444_2plane_formats, VK_FORMAT_G8_B8R8_2PLANE_444_UNORM, format);
+    if (!found)
+        found = lookup_range(packed_4444_formats, VK_FORMAT_A4R4G4B4_UNORM_PACK16, format);
+    if (!found)
+        found = lookup_range(astc_hdr_formats, VK_FORMAT_ASTC_4x4_SFLOAT_BLOCK, format);
+    if (!found)
+        found = lookup_range(pvrtc_formats, VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG, format);
+    if (!found)
+        found = lookup_range(maintenance5_formats, VK_FORMAT_A1B5G5R5_UNORM_PACK16_KHR, format);
+    if (!found && format == VK_FORMAT_R16G16_S10_5_NV)
+        found = &r16g16_s10_5_nv;
+
+    if (!found || found->aspects == 0)
+        throw std::runtime_error("TODO: unhandled format");
+    return *found;
+}
+
+VkDeviceSize FormatInfo::size_for(VkExtent3D extent) const {
+    if (block_size == 0)
+        throw std::runtime_error("Multi-planar formats need to be sized per plane");
+    VkDeviceSize blocks_x = (extent.width + block_width - 1) / block_width;
+    VkDeviceSize blocks_y = (extent.height + block_height - 1) / block_height;
+    return blocks_x * blocks_y * extent.depth * block_size;
+}
+
+}
@@ -1,6 +1,7 @@
 #include "swapchain_private.h"
 #include "imr/util.h"
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
@@ -14,6 +15,40 @@ void Swapchain::Frame::addCleanupAction(std::function<void(void)>&& fn) {
     _impl->cleanup_queue.push_back(std::move(fn));
 }
 
+/// Past this many rectangles, a slot's stale regions are merged into their bounding box
+static constexpr size_t max_stale_regions = 16;
+
+static VkRect2D bounding_box(const std::vector<VkRect2D>& regions) {
+    int32_t x0 = INT32_MAX, y0 = INT32_MAX, x1 = INT32_MIN, y1 = INT32_MIN;
+    for (auto& region : regions) {
+        x0 = std::min(x0, region.offset.x);
+        y0 = std::min(y0, region.offset.y);
+        x1 = std::max(x1, region.offset.x + (int32_t) region.extent.width);
+        y1 = std::max(y1, region.offset.y + (int32_t) region.extent.height);
+    }
+    return { { x0, y0 }, { uint32_t(x1 - x0), uint32_t(y1 - y0) } };
+}
+
+void Swapchain::Frame::addDirtyRegion(VkRect2D region) {
+    assert(!_impl->submitted && "Dirty regions must be declared before presenting");
+    VkExtent2D extent = _impl->slot.swapchain._impl->swapchain.extent;
+    int32_t x0 = std::max(region.offset.x, 0);
+    int32_t y0 = std::max(region.offset.y, 0);
+    int32_t x1 = std::min(region.offset.x + (int32_t) region.extent.width, (int32_t) extent.width);
+    int32_t y1 = std::min(region.offset.y + (int32_t) region.extent.height, (int32_t) extent.height);
+    if (x1 <= x0 || y1 <= y0)
+        return;
+    _impl->dirty_regions.push_back({ { x0, y0 }, { uint32_t(x1 - x0), uint32_t(y1 - y0) } });
+}
+
+std::optional<std::vector<VkRect2D>> Swapchain::Frame::Impl::regions_to_refresh() const {
+    if (dirty_regions.empty() || !slot.contents_valid)
+        return std::nullopt;
+    std::vector<VkRect2D> regions = slot.stale_regions;
+    regions.insert(regions.end(), dirty_regions.begin(), dirty_regions.end());
+    return regions;
+}
+
 Swapchain::Frame::Frame(Impl&& impl) {
     _impl = std::make_unique<Frame::Impl>(std::move(impl));
 }
@@ -54,11 +89,66 @@ void Swapchain::Frame::queuePresent() {
     assert(!_impl->submitted && "Cannot submit a frame twice!");
     _impl->submitted = true;
 
+    // the frame's work was only queued so far, this gets it to the GPU in one go without waiting for the present
+    CHECK_VK_THROW(device.flushSubmits());
+
+    PresentRequest request = {
+        .swapchain = swapchain._impl->swapchain.swapchain,
+        .image_index = slot.image_index,
+        .wait = slot.present_semaphore,
+    };
+    // lets the compositor only pick up what changed
+    for (auto& region : _impl->dirty_regions)
+        request.rects.push_back({ region.offset, region.extent, 0 });
+
+    auto& present_thread = swapchain._impl->present_thread;
+    if (swapchain.asyncPresent) {
+        if (!present_thread)
+            present_thread = std::make_unique<PresentThread>(*swapchain._impl);
+        if (VkResult error = present_thread->error.exchange(VK_SUCCESS); error != VK_SUCCESS) {
+            fprintf(stderr, "Present result was: %d\n", error);
+            throw std::runtime_error("unhandled queuePresent result");
+        }
+        present_thread->push(std::move(request));
+    } else {
+        // earlier frames might still be waiting on the present thread
+        if (present_thread)
+            present_thread->wait_idle();
+        switch (swapchain._impl->present(request)) {
+            case VK_SUCCESS:
+            case VK_SUBOPTIMAL_KHR: break;
+            case VK_ERROR_OUT_OF_DATE_KHR: {
+                fprintf(stderr, "Present failed. We need to resize!\n");
+                break;
+            }
+            default: throw std::runtime_error("unhandled queuePresent result");
+        }
+    }
+
+    // this image is now current, the others fall behind by what this frame changed
+    slot.contents_valid = true;
+    slot.stale_regions.clear();
+    for (auto& other : swapchain._impl->slots) {
+        if (other.get() == &slot)
+            continue;
+        if (_impl->dirty_regions.empty()) {
+            other->contents_valid = false;
+            other->stale_regions.clear();
+            continue;
+        }
+        auto& stale = other->stale_regions;
+        stale.insert(stale.end(), _impl->dirty_regions.begin(), _impl->dirty_regions.end());
+        if (stale.size() > max_stale_regions)
+            stale = { bounding_box(stale) };
+    }
+}
+
+VkResult Swapchain::Impl::present(const PresentRequest& request) {
     uint64_t now = imr_get_time_nano();
-    uint64_t delta = now - swapchain._impl->last_present;
+    uint64_t delta = now - last_present;
     int64_t delta_us = (int64_t)(delta / 1000);
 
-    int64_t min_delta = int64_t(1000000.0 / swapchain.maxFps);
+    int64_t min_delta = int64_t(1000000.0 / parent.maxFps);
     //printf("delta: %zu us, min_delta = %zu \n", delta_us, min_delta);
     int64_t sleep_time = min_delta - delta_us;
     if (sleep_time > 0) {
@@ -66,31 +156,30 @@ void Swapchain::Frame::queuePresent() {
         std::this_thread::sleep_for(std::chrono::microseconds(sleep_time));
     }
 
-    swapchain._impl->last_present = now;
-
-    //printf("Presenting in slot: %d\n", slot.image_index);
+    last_present = now;
 
-    std::vector<VkSemaphore> semaphores;
-    semaphores.push_back(slot.present_semaphore);
+    //printf("Presenting in slot: %d\n", request.image_index);
 
-    VkResult present_result = vkQueuePresentKHR(device.main_queue, tmpPtr((VkPresentInfoKHR) {
+    VkPresentRegionsKHR present_regions = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR,
+        .swapchainCount = 1,
+        .pRegions = tmpPtr((VkPresentRegionKHR) {
+            .rectangleCount = static_cast<uint32_t>(request.rects.size()),
+            .pRectangles = request.rects.data(),
+        }),
+    };
+    bool incremental = !request.rects.empty() && device.features().incremental_present;
+
+    std::lock_guard lock(swapchain_mutex);
+    return device.present((VkPresentInfoKHR) {
         .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-        .waitSemaphoreCount = static_cast<uint32_t>(semaphores.size()),
-        .pWaitSemaphores = semaphores.data(),
+        .pNext = incremental ? &present_regions : nullptr,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &request.wait,
         .swapchainCount = 1,
-        .pSwapchains = &swapchain._impl->swapchain.swapchain,
-        .pImageIndices = &slot.image_index,
-    }));
-    //printf("Queued presentation, will signal %llx\n", (uint64_t) slot.wait_for_previous_present);
-    switch (present_result) {
-        case VK_SUCCESS:
-        case VK_SUBOPTIMAL_KHR: break;
-        case VK_ERROR_OUT_OF_DATE_KHR: {
-            fprintf(stderr, "Present failed. We need to resize!\n");
-            break;
-        }
-        default: throw std::runtime_error("unhandled queuePresent result");
-    }
+        .pSwapchains = &request.swapchain,
+        .pImageIndices = &request.image_index,
+    });
 }
 
 void Swapchain::beginFrame(std::function<void(Swapchain::Frame&)>&& fn) {
@@ -98,7 +187,8 @@ void Swapchain::beginFrame(std::function<void(Swapchain::Frame&)>&& fn) {
     while (true) {
         if (_impl->should_resize) {
             _impl->should_resize = false;
-            glfwPollEvents();
+            if (!_impl->glfw_on_other_thread)
+                glfwPollEvents();
             drain();
             _impl->destroy_swapchain();
             _impl->build_swapchain();
@@ -0,0 +1,137 @@
+#include "swapchain_private.h"
+
+#include "imr/util.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace imr {
+
+/// How often the simulation thread looks at window events while it waits for the renderer
+static constexpr auto event_poll_interval = std::chrono::milliseconds(2);
+
+struct FrameLoop::Impl {
+    Swapchain& swapchain;
+    GLFWwindow* window;
+
+    std::mutex mutex;
+    std::condition_variable published;
+    std::condition_variable consumed;
+    /// The slots are owned by the simulation (`back`), the renderer (`front`) or neither (`middle`), and only ever swapped with `middle`
+    uint32_t back = 0;
+    uint32_t middle = 1;
+    uint32_t front = 2;
+    /// `middle` holds a snapshot the renderer hasn't seen yet
+    bool fresh = false;
+    bool quit = false;
+    std::exception_ptr render_error;
+
+    void publish() {
+        std::lock_guard lock(mutex);
+        std::swap(back, middle);
+        fresh = true;
+        published.notify_one();
+    }
+
+    /// Returns false once the loop is over
+    bool acquire() {
+        std::unique_lock lock(mutex);
+        published.wait(lock, [&]() { return fresh || quit; });
+        if (quit)
+            return false;
+        std::swap(front, middle);
+        fresh = false;
+        consumed.notify_one();
+        return true;
+    }
+
+    void stop() {
+        std::lock_guard lock(mutex);
+        quit = true;
+        published.notify_one();
+        consumed.notify_one();
+    }
+
+    void report_framebuffer_size() {
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        swapchain._impl->framebuffer_size = (uint64_t(uint32_t(width)) << 32) | uint32_t(height);
+    }
+};
+
+FrameLoop::FrameLoop(Swapchain& swapchain, GLFWwindow* window) {
+    _impl = std::make_unique<Impl>(swapchain, window);
+}
+
+FrameLoop::~FrameLoop() = default;
+
+void FrameLoop::run(std::function<void(uint32_t slot, double delta_seconds)>&& simulate, std::function<void(uint32_t slot, Swapchain::SimplifiedRenderContext&)>&& render) {
+    auto& impl = *_impl;
+    auto& swapchain = impl.swapchain;
+    impl.quit = false;
+    impl.fresh = false;
+    impl.render_error = nullptr;
+
+    impl.report_framebuffer_size();
+    swapchain._impl->glfw_on_other_thread = true;
+
+    std::thread render_thread([&]() {
+        try {
+            while (impl.acquire()) {
+                uint32_t slot = impl.front;
+                swapchain.renderFrameSimplified([&](Swapchain::SimplifiedRenderContext& context) {
+                    render(slot, context);
+                });
+            }
+        } catch (...) {
+            impl.render_error = std::current_exception();
+            impl.stop();
+        }
+    });
+
+    std::exception_ptr simulate_error;
+    try {
+        uint64_t last = imr_get_time_nano();
+        while (true) {
+            glfwPollEvents();
+            impl.report_framebuffer_size();
+            if (glfwWindowShouldClose(impl.window))
+                break;
+
+            uint64_t now = imr_get_time_nano();
+            simulate(impl.back, double(now - last) / 1000000000.0);
+            last = now;
+            impl.publish();
+
+            // stay at most one snapshot ahead, while keeping the window responsive
+            std::unique_lock lock(impl.mutex);
+            while (impl.fresh && !impl.quit) {
+                impl.consumed.wait_for(lock, event_poll_interval);
+                lock.unlock();
+                glfwPollEvents();
+                impl.report_framebuffer_size();
+                lock.lock();
+                if (glfwWindowShouldClose(impl.window))
+                    break;
+            }
+            if (impl.quit)
+                break;
+        }
+    } catch (...) {
+        simulate_error = std::current_exception();
+    }
+
+    impl.stop();
+    render_thread.join();
+    swapchain._impl->glfw_on_other_thread = false;
+    swapchain.drain();
+
+    if (simulate_error)
+        std::rethrow_exception(simulate_error);
+    if (impl.render_error)
+        std::rethrow_exception(impl.render_error);
+}
+
+}
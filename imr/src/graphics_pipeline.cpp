@@ -9,11 +9,11 @@ T* optional_to_ptr(std::optional<T>& o) {
     return nullptr;
 }
 
-GraphicsPipeline::GraphicsPipeline(imr::Device& d, std::vector<ShaderEntryPoint*>&& stages, RenderTargetsState rts, imr::GraphicsPipeline::StateBuilder state) {
-    _impl = std::make_unique<Impl>(d, std::move(stages), rts, state);
+GraphicsPipeline::GraphicsPipeline(imr::Device& d, std::vector<ShaderEntryPoint*>&& stages, RenderTargetsState rts, imr::GraphicsPipeline::StateBuilder state, BindlessTable* bindless_table) {
+    _impl = std::make_unique<Impl>(d, std::move(stages), rts, state, bindless_table);
 }
 
-GraphicsPipeline::Impl::Impl(Device& device, std::vector<ShaderEntryPoint*>&& stages, RenderTargetsState render_targets, StateBuilder state) : device_(device) {
+GraphicsPipeline::Impl::Impl(Device& device, std::vector<ShaderEntryPoint*>&& stages, RenderTargetsState render_targets, StateBuilder state, BindlessTable* bindless_table) : device_(device) {
     std::vector<VkPipelineShaderStageCreateInfo> vk_stages;
     VkShaderStageFlags conflicts = 0;
     std::optional<ReflectedLayout> merged_layout;
@@ -33,7 +33,7 @@ GraphicsPipeline::Impl::Impl(Device& device, std::vector<ShaderEntryPoint*>&& st
             merged_layout = ReflectedLayout(*merged_layout, *stage->_impl->reflected);
     }
 
-    layout = std::make_unique<PipelineLayout>(device, *merged_layout);
+    layout = std::make_unique<PipelineLayout>(device, *merged_layout, false, bindless_table);
     final_layout = *merged_layout;
 
     std::vector<VkDynamicState> dynamic_states = {
@@ -0,0 +1,121 @@
+#include "swapchain_private.h"
+
+namespace imr {
+
+HostFramebuffer::HostFramebuffer(Device& device, VkImage image, VkExtent2D size, VkFormat format) : device(device) {
+    auto& vk = device.dispatch;
+
+    buffer = std::make_unique<Buffer>(device, size_t(size.width) * size.height * format_info(format).block_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    mapped = static_cast<uint8_t*>(buffer->map());
+
+    CHECK_VK_THROW(vkCreateFence(device.device, tmpPtr((VkFenceCreateInfo) {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+    }), nullptr, &copy_done));
+
+    CHECK_VK_THROW(vkAllocateCommandBuffers(device.device, tmpPtr((VkCommandBufferAllocateInfo) {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = device.pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    }), &copy_cmdbuf));
+
+    // no ONE_TIME_SUBMIT: this gets submitted once per use of the slot
+    CHECK_VK_THROW(vkBeginCommandBuffer(copy_cmdbuf, tmpPtr((VkCommandBufferBeginInfo) {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    })));
+
+    VkImageSubresourceRange range = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .levelCount = 1,
+        .layerCount = 1,
+    };
+    // the host writes are made available by the submission itself
+    vk.cmdPipelineBarrier2KHR(copy_cmdbuf, tmpPtr((VkDependencyInfo) {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = tmpPtr((VkImageMemoryBarrier2) {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+            .srcAccessMask = VK_ACCESS_2_NONE,
+            .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .image = image,
+            .subresourceRange = range,
+        }),
+    }));
+    vkCmdCopyBufferToImage(copy_cmdbuf, buffer->handle, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, tmpPtr((VkBufferImageCopy) {
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .layerCount = 1,
+        },
+        .imageExtent = { size.width, size.height, 1 },
+    }));
+    vk.cmdPipelineBarrier2KHR(copy_cmdbuf, tmpPtr((VkDependencyInfo) {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = tmpPtr((VkImageMemoryBarrier2) {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+            .dstAccessMask = VK_ACCESS_2_NONE,
+            .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            .image = image,
+            .subresourceRange = range,
+        }),
+    }));
+    CHECK_VK_THROW(vkEndCommandBuffer(copy_cmdbuf));
+}
+
+HostFramebuffer::~HostFramebuffer() {
+    vkWaitForFences(device.device, 1, &copy_done, true, UINT64_MAX);
+    vkDestroyFence(device.device, copy_done, nullptr);
+    vkFreeCommandBuffers(device.device, device.pool, 1, &copy_cmdbuf);
+    buffer->unmap();
+}
+
+void Swapchain::renderFrameFromHost(std::function<void(HostRenderContext&)>&& fn) {
+    auto& device = this->device();
+
+    beginFrame([&](Frame& frame) {
+        auto& slot = frame._impl->slot;
+        VkExtent2D size = _impl->swapchain.extent;
+        VkFormat format = _impl->swapchain.image_format;
+        // slots are rebuilt along with the swapchain, so this only happens on first use and after a resize
+        if (!slot.host_framebuffer)
+            slot.host_framebuffer = std::make_unique<HostFramebuffer>(device, slot.image, size, format);
+        auto& host = *slot.host_framebuffer;
+
+        HostRenderContext context = {
+            .pixels = host.mapped,
+            .size = size,
+            .row_pitch = size_t(size.width) * format_info(format).block_size,
+            .format = format,
+            .frame = frame,
+        };
+        fn(context);
+
+        // the previous frame in this slot is done with the buffer, its cleanup waited on the fence.
+        // Reset only now: if `fn` throws, the fence has to stay signalled for ~HostFramebuffer
+        CHECK_VK_THROW(vkResetFences(device.device, 1, &host.copy_done));
+        CHECK_VK_THROW(device.enqueueSubmit((VkSubmitInfo) {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &frame.swapchain_image_available,
+            .pWaitDstStageMask = tmpPtr((VkPipelineStageFlags) VK_PIPELINE_STAGE_TRANSFER_BIT),
+            .commandBufferCount = 1,
+            .pCommandBuffers = &host.copy_cmdbuf,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &frame.signal_when_ready,
+        }, host.copy_done));
+        frame.addCleanupFence(host.copy_done);
+
+        frame.queuePresent();
+    });
+}
+
+}
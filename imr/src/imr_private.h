@@ -5,17 +5,113 @@
 
 #include "vk_mem_alloc.h"
 
+#include <unordered_map>
+#include <mutex>
+
 #define CHECK_VK_THROW(do) CHECK_VK(do, throw std::runtime_error(#do))
 
 namespace imr {
 
+/// The parts of VkSamplerCreateInfo that identify a sampler, so equivalent create infos share one VkSampler
+struct SamplerKey {
+    VkSamplerCreateFlags flags;
+    VkFilter mag_filter;
+    VkFilter min_filter;
+    VkSamplerMipmapMode mipmap_mode;
+    VkSamplerAddressMode address_mode_u;
+    VkSamplerAddressMode address_mode_v;
+    VkSamplerAddressMode address_mode_w;
+    float mip_lod_bias;
+    VkBool32 anisotropy_enable;
+    float max_anisotropy;
+    VkBool32 compare_enable;
+    VkCompareOp compare_op;
+    float min_lod;
+    float max_lod;
+    VkBorderColor border_color;
+    VkBool32 unnormalized_coordinates;
+
+    explicit SamplerKey(const VkSamplerCreateInfo&);
+    bool operator==(const SamplerKey&) const = default;
+};
+
+struct SamplerKeyHash {
+    size_t operator()(const SamplerKey&) const;
+};
+
+/// Hash-conses descriptor set layouts and pipeline layouts, so pipelines with the same interface share the same handles.
+/// Compatible pipeline layouts let descriptor sets stay bound when switching pipelines. The handles live as long as the device.
+struct LayoutCache {
+    /// maxPushConstantsSize every device supports, single push constant ranges are widened to this so they compare equal
+    static constexpr uint32_t min_push_constants_size = 128;
+
+    struct SetLayoutKey {
+        /// sorted by binding number, immutable samplers are not supported
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        std::vector<VkDescriptorBindingFlags> flags;
+        VkDescriptorSetLayoutCreateFlags create_flags;
+
+        bool operator==(const SetLayoutKey&) const;
+    };
+    struct PipelineLayoutKey {
+        std::vector<VkDescriptorSetLayout> set_layouts;
+        std::vector<VkPushConstantRange> push_constants;
+
+        bool operator==(const PipelineLayoutKey&) const;
+    };
+    struct Hash {
+        size_t operator()(const SetLayoutKey&) const;
+        size_t operator()(const PipelineLayoutKey&) const;
+    };
+
+    std::unordered_map<SetLayoutKey, VkDescriptorSetLayout, Hash> set_layouts;
+    std::unordered_map<PipelineLayoutKey, VkPipelineLayout, Hash> pipeline_layouts;
+
+    VkDescriptorSetLayout get_set_layout(Device&, std::vector<VkDescriptorSetLayoutBinding> bindings, const std::vector<VkDescriptorBindingFlags>& flags, VkDescriptorSetLayoutCreateFlags create_flags = 0);
+    VkPipelineLayout get_pipeline_layout(Device&, const std::vector<VkDescriptorSetLayout>& sets, const std::vector<VkPushConstantRange>& push_constants);
+    void destroy(Device&);
+};
+
+/// Submissions queued with Device::enqueueSubmit, handed to the queue in a single vkQueueSubmit2
+struct SubmitBatch {
+    struct Submission {
+        std::vector<VkSemaphoreSubmitInfo> waits;
+        std::vector<VkCommandBufferSubmitInfo> command_buffers;
+        std::vector<VkSemaphoreSubmitInfo> signals;
+    };
+    std::vector<Submission> submissions;
+    /// A call can only signal one fence, so a second one flushes the batch first
+    VkFence fence = VK_NULL_HANDLE;
+};
+
 struct Device::Impl {
     VmaAllocator allocator;
+    ComputeCapabilities compute_capabilities;
+    DeviceFeatures features;
+    uint32_t max_push_descriptors = 0;
+    size_t host_import_alignment = 0;
+    /// Whether the main queue can time work with vkCmdWriteTimestamp, see timestamp_ms()
+    bool has_timestamps = false;
+    /// Timestamps only have this many valid low bits
+    uint64_t timestamp_mask = 0;
 
     //std::vector<std::unique_ptr<Buffer>> buffers;
     std::vector<std::unique_ptr<Image>> images;
+
+    std::unordered_map<SamplerKey, VkSampler, SamplerKeyHash> samplers;
+    LayoutCache layouts;
+
+    /// Guards main_queue and `pending_submits`, see Device::submit
+    std::mutex main_queue_mutex;
+    SubmitBatch pending_submits;
 };
 
+/// For the SPIR-V headers generated from src/kernels/
+template<size_t N>
+static std::vector<uint32_t> embedded_spirv(const uint32_t (&words)[N]) {
+    return std::vector<uint32_t>(words, words + N);
+}
+
 static inline void appendPNext(VkBaseOutStructure* base, VkBaseOutStructure* ext) {
     while (base->pNext) {
         base = base->pNext;
@@ -23,6 +119,11 @@ static inline void appendPNext(VkBaseOutStructure* base, VkBaseOutStructure* ext
     base->pNext = ext;
 }
 
+VkImageViewType image_type_to_view_type(VkImageType type);
+
+/// Time between two timestamps written on the device's main queue, correct across a wrap of the valid bits
+double timestamp_ms(Device& device, uint64_t begin, uint64_t end);
+
 Image make_image_from(Device& device, VkImage existing_handle, VkImageType dim, VkExtent3D size, VkFormat format);
 
 }
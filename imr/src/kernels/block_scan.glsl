@@ -0,0 +1,40 @@
+// Workgroup-wide exclusive prefix sum, built on subgroup arithmetic so it works with whatever subgroup size the driver picks.
+// Expects WORKGROUP_SIZE to be defined and the GL_KHR_shader_subgroup_basic and _arithmetic extensions to be enabled, and must be called from uniform control flow.
+
+shared uint block_scan_partials[WORKGROUP_SIZE];
+shared uint block_scan_total;
+
+/// Position of the invocation in the order the scan runs in, use this rather than gl_LocalInvocationIndex to lay out data
+/// This is dense when subgroups are full, which the library asks for when the device lets it
+uint thread_rank() {
+    return gl_SubgroupID * gl_SubgroupSize + gl_SubgroupInvocationID;
+}
+
+uint block_exclusive_scan(uint value, out uint total) {
+    uint inclusive = subgroupInclusiveAdd(value);
+    if (gl_SubgroupInvocationID == gl_SubgroupSize - 1)
+        block_scan_partials[gl_SubgroupID] = inclusive;
+    barrier();
+
+    // small subgroups mean there can be more subgroups than lanes in one, hence the loop
+    if (gl_SubgroupID == 0) {
+        uint carry = 0;
+        for (uint base = 0; base < gl_NumSubgroups; base += gl_SubgroupSize) {
+            uint i = base + gl_SubgroupInvocationID;
+            uint partial = i < gl_NumSubgroups ? block_scan_partials[i] : 0u;
+            uint partial_inclusive = subgroupInclusiveAdd(partial);
+            if (i < gl_NumSubgroups)
+                block_scan_partials[i] = carry + partial_inclusive - partial;
+            carry += subgroupAdd(partial);
+        }
+        if (subgroupElect())
+            block_scan_total = carry;
+    }
+    barrier();
+
+    total = block_scan_total;
+    uint result = block_scan_partials[gl_SubgroupID] + inclusive - value;
+    // the next call reuses the shared memory
+    barrier();
+    return result;
+}
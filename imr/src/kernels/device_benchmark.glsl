@@ -0,0 +1,34 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_scalar_block_layout : require
+
+// Independent FMA chains, enough of them to hide the latency. The results are written out so none of it gets optimized away.
+
+#define WORKGROUP_SIZE 256
+
+layout(local_size_x = WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+layout(buffer_reference, scalar) buffer Results {
+    vec4 data[];
+};
+
+layout(scalar, push_constant) uniform T {
+    Results results;
+    uint iterations;
+} push_constants;
+
+void main() {
+    vec4 a = vec4(gl_GlobalInvocationID.x) * 1e-6;
+    vec4 b = a + 0.25;
+    vec4 c = a + 0.5;
+    vec4 d = a + 0.75;
+    const vec4 m = vec4(0.9999);
+    const vec4 k = vec4(1e-4);
+    for (uint i = 0; i < push_constants.iterations; i++) {
+        a = fma(a, m, k);
+        b = fma(b, m, k);
+        c = fma(c, m, k);
+        d = fma(d, m, k);
+    }
+    push_constants.results.data[gl_GlobalInvocationID.x] = a + b + c + d;
+}
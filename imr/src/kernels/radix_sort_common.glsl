@@ -0,0 +1,29 @@
+// Key representation shared by the radix sort kernels: 8-bit digits, 64-bit keys are stored as (low, high) pairs so we don't need shaderInt64.
+
+#define RADIX 256
+#define RADIX_MASK 0xFF
+
+#ifdef KEY64
+#define Key uvec2
+#define KEY_PASSES 8
+#define KEY_PADDING uvec2(0xFFFFFFFFu)
+uint key_digit(Key key, uint pass) {
+    uint shift = pass * 8;
+    return ((shift < 32 ? key.x : key.y) >> (shift & 31)) & RADIX_MASK;
+}
+#else
+#define Key uint
+#define KEY_PASSES 4
+#define KEY_PADDING 0xFFFFFFFFu
+uint key_digit(Key key, uint pass) {
+    return (key >> (pass * 8)) & RADIX_MASK;
+}
+#endif
+
+layout(scalar, buffer_reference) buffer Keys {
+    Key data[];
+};
+
+layout(scalar, buffer_reference) buffer Uints {
+    uint data[];
+};
@@ -0,0 +1,44 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_GOOGLE_include_directive : require
+
+// Counts the digits of every pass in one go, so the onesweep passes only have to read the keys once each.
+
+#define WORKGROUP_SIZE 256
+#define ITEMS_PER_THREAD 8
+#define TILE_SIZE (WORKGROUP_SIZE * ITEMS_PER_THREAD)
+
+layout(local_size_x = WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+#include "radix_sort_common.glsl"
+
+layout(scalar, push_constant) uniform T {
+    Keys keys;
+    Uints histograms;
+    uint count;
+} push_constants;
+
+shared uint local_histograms[KEY_PASSES * RADIX];
+
+void main() {
+    for (uint i = gl_LocalInvocationIndex; i < KEY_PASSES * RADIX; i += WORKGROUP_SIZE)
+        local_histograms[i] = 0;
+    barrier();
+
+    uint tile_base = gl_WorkGroupID.x * TILE_SIZE;
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        uint index = tile_base + i * WORKGROUP_SIZE + gl_LocalInvocationIndex;
+        if (index >= push_constants.count)
+            break;
+        Key key = push_constants.keys.data[index];
+        for (uint pass = 0; pass < KEY_PASSES; pass++)
+            atomicAdd(local_histograms[pass * RADIX + key_digit(key, pass)], 1);
+    }
+    barrier();
+
+    for (uint i = gl_LocalInvocationIndex; i < KEY_PASSES * RADIX; i += WORKGROUP_SIZE) {
+        if (local_histograms[i] != 0)
+            atomicAdd(push_constants.histograms.data[i], local_histograms[i]);
+    }
+}
@@ -0,0 +1,166 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_GOOGLE_include_directive : require
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
+
+// One LSD radix sort pass in a single dispatch, after Adinets & Merrill, "Onesweep: A Faster Least Significant Digit Radix Sort for GPUs".
+// Each partition sorts its tile locally on the current digit, then finds where each digit goes with a decoupled lookback over the per-digit counts of the previous partitions.
+
+#define WORKGROUP_SIZE 256
+#ifdef KEY64
+#define ITEMS_PER_THREAD 4
+#else
+#define ITEMS_PER_THREAD 8
+#endif
+#define TILE_SIZE (WORKGROUP_SIZE * ITEMS_PER_THREAD)
+
+layout(local_size_x = WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+#include "block_scan.glsl"
+#include "radix_sort_common.glsl"
+
+// one thread per digit
+#if WORKGROUP_SIZE != RADIX
+#error "The onesweep kernel assumes one invocation per digit"
+#endif
+
+// lookback states pack a flag in the top two bits, which caps the sort at 2^30 keys
+#define FLAG_NOT_READY 0u
+#define FLAG_AGGREGATE 1u
+#define FLAG_INCLUSIVE 2u
+#define FLAG_SHIFT 30
+#define VALUE_MASK 0x3FFFFFFFu
+
+layout(scalar, buffer_reference) coherent buffer Lookback {
+    uint data[];
+};
+
+layout(scalar, buffer_reference) coherent buffer Counter {
+    uint value;
+};
+
+layout(scalar, push_constant) uniform T {
+    Keys keys_in;
+    Keys keys_out;
+    Uints payloads_in;
+    Uints payloads_out;
+    /// digit counts of this pass
+    Uints histogram;
+    Counter partition_counter;
+    /// RADIX states per partition
+    Lookback lookback;
+    uint count;
+    uint pass;
+    uint has_payloads;
+} push_constants;
+
+shared Key tile_keys[TILE_SIZE];
+shared uint tile_payloads[TILE_SIZE];
+shared uint digit_start[RADIX];
+shared uint digit_end[RADIX];
+shared uint digit_base[RADIX];
+shared uint partition_index;
+
+void main() {
+    // partitions are handed out in launch order rather than by gl_WorkGroupID, so every partition we wait on has at least started
+    if (gl_LocalInvocationIndex == 0)
+        partition_index = atomicAdd(push_constants.partition_counter.value, 1);
+    barrier();
+    uint partition = partition_index;
+    uint rank = thread_rank();
+    uint pass = push_constants.pass;
+    bool has_payloads = push_constants.has_payloads != 0;
+    uint tile_base = partition * TILE_SIZE;
+    uint tile_count = min(uint(TILE_SIZE), push_constants.count - tile_base);
+
+    // padding keys sort after every real key with the same digit, so they stay at the end of the tile
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        uint j = i * WORKGROUP_SIZE + rank;
+        tile_keys[j] = j < tile_count ? push_constants.keys_in.data[tile_base + j] : KEY_PADDING;
+        if (has_payloads)
+            tile_payloads[j] = j < tile_count ? push_constants.payloads_in.data[tile_base + j] : 0u;
+    }
+    barrier();
+
+    Key keys[ITEMS_PER_THREAD];
+    uint payloads[ITEMS_PER_THREAD];
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        keys[i] = tile_keys[rank * ITEMS_PER_THREAD + i];
+        payloads[i] = has_payloads ? tile_payloads[rank * ITEMS_PER_THREAD + i] : 0u;
+    }
+
+    // stable local sort on the digit, as a series of 1-bit splits
+    for (uint bit = 0; bit < 8; bit++) {
+        uint zeros = 0;
+        for (uint i = 0; i < ITEMS_PER_THREAD; i++)
+            zeros += ((key_digit(keys[i], pass) >> bit) & 1) == 0 ? 1u : 0u;
+        uint total_zeros;
+        uint zeros_before = block_exclusive_scan(zeros, total_zeros);
+        uint ones_before = rank * ITEMS_PER_THREAD - zeros_before;
+
+        for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+            bool one = ((key_digit(keys[i], pass) >> bit) & 1) != 0;
+            uint dst = one ? total_zeros + ones_before++ : zeros_before++;
+            tile_keys[dst] = keys[i];
+            if (has_payloads)
+                tile_payloads[dst] = payloads[i];
+        }
+        barrier();
+
+        for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+            keys[i] = tile_keys[rank * ITEMS_PER_THREAD + i];
+            payloads[i] = has_payloads ? tile_payloads[rank * ITEMS_PER_THREAD + i] : 0u;
+        }
+        barrier();
+    }
+
+    // tile_keys is sorted on the digit now, find where each digit's run starts and ends
+    digit_start[gl_LocalInvocationIndex] = 0;
+    digit_end[gl_LocalInvocationIndex] = 0;
+    barrier();
+    for (uint j = gl_LocalInvocationIndex; j < tile_count; j += WORKGROUP_SIZE) {
+        uint digit = key_digit(tile_keys[j], pass);
+        if (j == 0 || key_digit(tile_keys[j - 1], pass) != digit)
+            digit_start[digit] = j;
+        if (j == tile_count - 1 || key_digit(tile_keys[j + 1], pass) != digit)
+            digit_end[digit] = j + 1;
+    }
+    barrier();
+
+    uint digit = rank;
+    uint digit_count = digit_end[digit] - digit_start[digit];
+    uint unused;
+    uint global_offset = block_exclusive_scan(push_constants.histogram.data[digit], unused);
+
+    uint prefix = 0;
+    uint slot = partition * RADIX + digit;
+    if (partition == 0) {
+        atomicExchange(push_constants.lookback.data[slot], (FLAG_INCLUSIVE << FLAG_SHIFT) | digit_count);
+    } else {
+        atomicExchange(push_constants.lookback.data[slot], (FLAG_AGGREGATE << FLAG_SHIFT) | digit_count);
+        int p = int(partition) - 1;
+        while (p >= 0) {
+            uint state = atomicOr(push_constants.lookback.data[p * RADIX + digit], 0u);
+            uint flag = state >> FLAG_SHIFT;
+            if (flag == FLAG_NOT_READY)
+                continue;
+            prefix += state & VALUE_MASK;
+            if (flag == FLAG_INCLUSIVE)
+                break;
+            p--;
+        }
+        atomicExchange(push_constants.lookback.data[slot], (FLAG_INCLUSIVE << FLAG_SHIFT) | (prefix + digit_count));
+    }
+    digit_base[digit] = global_offset + prefix - digit_start[digit];
+    barrier();
+
+    for (uint j = gl_LocalInvocationIndex; j < tile_count; j += WORKGROUP_SIZE) {
+        Key key = tile_keys[j];
+        uint dst = digit_base[key_digit(key, pass)] + j;
+        push_constants.keys_out.data[dst] = key;
+        if (has_payloads)
+            push_constants.payloads_out.data[dst] = tile_payloads[j];
+    }
+}
@@ -0,0 +1,151 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_GOOGLE_include_directive : require
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#extension GL_KHR_shader_subgroup_ballot : require
+#extension GL_KHR_shader_subgroup_vote : require
+
+// Single-pass exclusive prefix sum using decoupled lookback (Merrill & Garland, "Single-pass Parallel Prefix Scan with Decoupled Look-back").
+// With COMPACT defined, it scans the (flags != 0) predicate instead, and uses the result to scatter the flagged elements.
+
+#define WORKGROUP_SIZE 256
+#define ITEMS_PER_THREAD 8
+#define TILE_SIZE (WORKGROUP_SIZE * ITEMS_PER_THREAD)
+
+layout(local_size_x = WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+#include "block_scan.glsl"
+
+#define FLAG_NOT_READY 0u
+#define FLAG_AGGREGATE 1u
+#define FLAG_INCLUSIVE 2u
+
+layout(scalar, buffer_reference) buffer Uints {
+    uint data[];
+};
+
+// Each partition has a flag, its own aggregate and its inclusive prefix. The last two are separate so that a flag and the value it refers to can't be torn.
+layout(scalar, buffer_reference) coherent buffer ScanState {
+    uint partition_counter;
+    uint descriptors[];
+};
+
+layout(scalar, push_constant) uniform T {
+    Uints input_buffer;
+    Uints output_buffer;
+#ifdef COMPACT
+    Uints flags_buffer;
+    Uints count_buffer;
+#endif
+    ScanState state;
+    uint count;
+} push_constants;
+
+shared uint tile[TILE_SIZE];
+shared uint partition_index;
+shared uint exclusive_prefix;
+
+void publish(uint partition, uint flag, uint value) {
+    atomicExchange(push_constants.state.descriptors[partition * 3 + flag], value);
+    memoryBarrierBuffer();
+    atomicExchange(push_constants.state.descriptors[partition * 3], flag);
+}
+
+uint load(uint index) {
+    if (index >= push_constants.count)
+        return 0;
+#ifdef COMPACT
+    return push_constants.flags_buffer.data[index] != 0 ? 1u : 0u;
+#else
+    return push_constants.input_buffer.data[index];
+#endif
+}
+
+void main() {
+    // partitions are handed out in launch order rather than by gl_WorkGroupID, so every partition we wait on has at least started
+    if (gl_LocalInvocationIndex == 0)
+        partition_index = atomicAdd(push_constants.state.partition_counter, 1);
+    barrier();
+    uint partition = partition_index;
+    uint rank = thread_rank();
+    uint tile_base = partition * TILE_SIZE;
+
+    // coalesced loads, then each thread takes a contiguous run of items
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++)
+        tile[i * WORKGROUP_SIZE + rank] = load(tile_base + i * WORKGROUP_SIZE + rank);
+    barrier();
+
+    uint values[ITEMS_PER_THREAD];
+    uint thread_sum = 0;
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        values[i] = tile[rank * ITEMS_PER_THREAD + i];
+        thread_sum += values[i];
+    }
+
+    uint tile_total;
+    uint thread_prefix = block_exclusive_scan(thread_sum, tile_total);
+
+    // the first subgroup looks back one partition per lane at a time
+    if (gl_SubgroupID == 0) {
+        uint prefix = 0;
+        if (partition == 0) {
+            if (subgroupElect())
+                publish(partition, FLAG_INCLUSIVE, tile_total);
+        } else {
+            if (subgroupElect())
+                publish(partition, FLAG_AGGREGATE, tile_total);
+
+            int window = int(partition) - 1;
+            while (true) {
+                int p = window - int(gl_SubgroupInvocationID);
+                // there is nothing before partition 0, so that is as good as an inclusive prefix of 0
+                uint flag = p >= 0 ? atomicOr(push_constants.state.descriptors[p * 3], 0u) : FLAG_INCLUSIVE;
+                if (subgroupAny(flag == FLAG_NOT_READY))
+                    continue;
+                memoryBarrierBuffer();
+                uint value = p >= 0 ? atomicOr(push_constants.state.descriptors[p * 3 + flag], 0u) : 0u;
+
+                uvec4 inclusive_lanes = subgroupBallot(flag == FLAG_INCLUSIVE);
+                if (inclusive_lanes != uvec4(0)) {
+                    uint first = subgroupBallotFindLSB(inclusive_lanes);
+                    prefix += subgroupAdd(gl_SubgroupInvocationID <= first ? value : 0u);
+                    break;
+                }
+                prefix += subgroupAdd(value);
+                window -= int(gl_SubgroupSize);
+            }
+
+            if (subgroupElect())
+                publish(partition, FLAG_INCLUSIVE, prefix + tile_total);
+        }
+        if (subgroupElect())
+            exclusive_prefix = prefix;
+    }
+    barrier();
+
+    uint running = exclusive_prefix + thread_prefix;
+#ifdef COMPACT
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        uint index = tile_base + rank * ITEMS_PER_THREAD + i;
+        if (values[i] != 0)
+            push_constants.output_buffer.data[running] = push_constants.input_buffer.data[index];
+        running += values[i];
+    }
+    uint partitions = (push_constants.count + TILE_SIZE - 1) / TILE_SIZE;
+    if (partition == partitions - 1 && gl_LocalInvocationIndex == 0)
+        push_constants.count_buffer.data[0] = exclusive_prefix + tile_total;
+#else
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        tile[rank * ITEMS_PER_THREAD + i] = running;
+        running += values[i];
+    }
+    barrier();
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        uint index = tile_base + i * WORKGROUP_SIZE + rank;
+        if (index < push_constants.count)
+            push_constants.output_buffer.data[index] = tile[i * WORKGROUP_SIZE + rank];
+    }
+#endif
+}
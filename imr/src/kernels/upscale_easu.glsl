@@ -0,0 +1,126 @@
+#version 450
+#extension GL_EXT_shader_image_load_formatted : require
+#extension GL_EXT_scalar_block_layout : require
+
+// Edge-adaptive spatial upscaling, after AMD's FidelityFX Super Resolution 1 EASU pass.
+// Each output pixel is a 12-tap filter around its source position, whose kernel is stretched along the local edge and deringed against the 4 nearest texels.
+
+layout(set = 0, binding = 0)
+uniform image2D source;
+
+layout(set = 0, binding = 1)
+uniform image2D destination;
+
+layout(scalar, push_constant) uniform T {
+    ivec2 source_size;
+    ivec2 destination_size;
+} push_constants;
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+vec3 fetch(ivec2 p) {
+    // the source may be a corner of a bigger image, so clamp rather than rely on the image's edges
+    return imageLoad(source, clamp(p, ivec2(0), push_constants.source_size - 1)).rgb;
+}
+
+float luma(vec3 c) {
+    return c.b * 0.5 + (c.r * 0.5 + c.g);
+}
+
+float safe_rcp(float x) {
+    return x != 0.0 ? 1.0 / x : 0.0;
+}
+
+// Accumulates the gradient direction and edge length of one of the 4 bilinear quadrants, given the luma at its centre and its 4 neighbours
+void easu_set(inout vec2 dir, inout float len, float w, float above, float left, float centre, float right, float below) {
+    float dir_x = right - left;
+    float len_x = clamp(abs(dir_x) * safe_rcp(max(abs(right - centre), abs(centre - left))), 0.0, 1.0);
+    dir.x += dir_x * w;
+    len += len_x * len_x * w;
+
+    float dir_y = below - above;
+    float len_y = clamp(abs(dir_y) * safe_rcp(max(abs(below - centre), abs(centre - above))), 0.0, 1.0);
+    dir.y += dir_y * w;
+    len += len_y * len_y * w;
+}
+
+// Approximate, windowed lanczos2 with the lobe adjusted by `lob`, evaluated along the rotated and scaled offset
+void easu_tap(inout vec3 colour, inout float weight, vec2 offset, vec2 dir, vec2 len2, float lob, float clp, vec3 c) {
+    vec2 v = vec2(offset.x * dir.x + offset.y * dir.y, offset.x * -dir.y + offset.y * dir.x) * len2;
+    float d2 = min(dot(v, v), clp);
+    float base = 2.0 / 5.0 * d2 - 1.0;
+    float window = lob * d2 - 1.0;
+    base = 25.0 / 16.0 * base * base - (25.0 / 16.0 - 1.0);
+    float w = base * window * window;
+    colour += c * w;
+    weight += w;
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    if (pixel.x >= push_constants.destination_size.x || pixel.y >= push_constants.destination_size.y)
+        return;
+
+    vec2 scale = vec2(push_constants.source_size) / vec2(push_constants.destination_size);
+    vec2 pp = (vec2(pixel) + 0.5) * scale - 0.5;
+    vec2 fp = floor(pp);
+    pp -= fp;
+    ivec2 p = ivec2(fp);
+
+    //    b c
+    //  e f g h
+    //  i j k l
+    //    n o
+    vec3 b = fetch(p + ivec2(0, -1)), c = fetch(p + ivec2(1, -1));
+    vec3 e = fetch(p + ivec2(-1, 0)), f = fetch(p), g = fetch(p + ivec2(1, 0)), h = fetch(p + ivec2(2, 0));
+    vec3 i = fetch(p + ivec2(-1, 1)), j = fetch(p + ivec2(0, 1)), k = fetch(p + ivec2(1, 1)), l = fetch(p + ivec2(2, 1));
+    vec3 n = fetch(p + ivec2(0, 2)), o = fetch(p + ivec2(1, 2));
+
+    float bL = luma(b), cL = luma(c), eL = luma(e), fL = luma(f), gL = luma(g), hL = luma(h);
+    float iL = luma(i), jL = luma(j), kL = luma(k), lL = luma(l), nL = luma(n), oL = luma(o);
+
+    vec2 dir = vec2(0.0);
+    float len = 0.0;
+    easu_set(dir, len, (1.0 - pp.x) * (1.0 - pp.y), bL, eL, fL, gL, jL);
+    easu_set(dir, len, pp.x * (1.0 - pp.y), cL, fL, gL, hL, kL);
+    easu_set(dir, len, (1.0 - pp.x) * pp.y, fL, iL, jL, kL, nL);
+    easu_set(dir, len, pp.x * pp.y, gL, jL, kL, lL, oL);
+
+    // flat areas get an arbitrary direction, they're filtered isotropically anyway
+    float dir_r = dot(dir, dir);
+    if (dir_r < 1.0 / 32768.0)
+        dir = vec2(1.0, 0.0);
+    else
+        dir *= inversesqrt(dir_r);
+
+    len = len * 0.5;
+    len *= len;
+    // diagonal edges stretch the kernel up to sqrt(2) along the edge
+    float stretch = dot(dir, dir) / max(abs(dir.x), abs(dir.y));
+    vec2 len2 = vec2(1.0 + (stretch - 1.0) * len, 1.0 - 0.5 * len);
+    // sharper lobes along strong edges
+    float lob = 0.5 + ((1.0 / 4.0 - 0.04) - 0.5) * len;
+    float clp = 1.0 / lob;
+
+    vec3 colour = vec3(0.0);
+    float weight = 0.0;
+    easu_tap(colour, weight, vec2(0.0, -1.0) - pp, dir, len2, lob, clp, b);
+    easu_tap(colour, weight, vec2(1.0, -1.0) - pp, dir, len2, lob, clp, c);
+    easu_tap(colour, weight, vec2(-1.0, 1.0) - pp, dir, len2, lob, clp, i);
+    easu_tap(colour, weight, vec2(0.0, 1.0) - pp, dir, len2, lob, clp, j);
+    easu_tap(colour, weight, vec2(0.0, 0.0) - pp, dir, len2, lob, clp, f);
+    easu_tap(colour, weight, vec2(-1.0, 0.0) - pp, dir, len2, lob, clp, e);
+    easu_tap(colour, weight, vec2(1.0, 1.0) - pp, dir, len2, lob, clp, k);
+    easu_tap(colour, weight, vec2(2.0, 1.0) - pp, dir, len2, lob, clp, l);
+    easu_tap(colour, weight, vec2(2.0, 0.0) - pp, dir, len2, lob, clp, h);
+    easu_tap(colour, weight, vec2(1.0, 0.0) - pp, dir, len2, lob, clp, g);
+    easu_tap(colour, weight, vec2(1.0, 2.0) - pp, dir, len2, lob, clp, o);
+    easu_tap(colour, weight, vec2(0.0, 2.0) - pp, dir, len2, lob, clp, n);
+
+    // the negative lobes would ring around edges, keep within what the nearest texels span
+    vec3 lo = min(min(f, g), min(j, k));
+    vec3 hi = max(max(f, g), max(j, k));
+    colour = clamp(colour / weight, lo, hi);
+
+    imageStore(destination, pixel, vec4(colour, 1.0));
+}
@@ -0,0 +1,54 @@
+#version 450
+#extension GL_EXT_shader_image_load_formatted : require
+#extension GL_EXT_scalar_block_layout : require
+
+// Contrast-adaptive sharpening, after AMD's FidelityFX Super Resolution 1 RCAS pass.
+// Sharpens with a 5-tap cross, as much as possible without any channel leaving the range its neighbours span.
+
+layout(set = 0, binding = 0)
+uniform image2D source;
+
+layout(set = 0, binding = 1)
+uniform image2D destination;
+
+layout(scalar, push_constant) uniform T {
+    ivec2 size;
+    /// 1 is the strongest, every halving is one stop less sharpening
+    float sharpness;
+} push_constants;
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// Keeps the lobe from going so negative that noise gets amplified
+const float rcas_limit = 0.25 - 1.0 / 16.0;
+
+vec3 fetch(ivec2 p) {
+    return imageLoad(source, clamp(p, ivec2(0), push_constants.size - 1)).rgb;
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    if (pixel.x >= push_constants.size.x || pixel.y >= push_constants.size.y)
+        return;
+
+    //    b
+    //  d e f
+    //    h
+    vec3 b = fetch(pixel + ivec2(0, -1));
+    vec3 d = fetch(pixel + ivec2(-1, 0));
+    vec3 e = fetch(pixel);
+    vec3 f = fetch(pixel + ivec2(1, 0));
+    vec3 h = fetch(pixel + ivec2(0, 1));
+
+    vec3 lo = min(min(b, d), min(f, h));
+    vec3 hi = max(max(b, d), max(f, h));
+
+    // the most negative lobe for which each channel still stays within [0, 1]
+    vec3 hit_lo = lo / max(4.0 * hi, 1.0 / 65536.0);
+    vec3 hit_hi = (vec3(1.0) - hi) / min(4.0 * lo - 4.0, -1.0 / 65536.0);
+    vec3 lobe_rgb = max(-hit_lo, hit_hi);
+    float lobe = max(-rcas_limit, min(max(lobe_rgb.r, max(lobe_rgb.g, lobe_rgb.b)), 0.0)) * push_constants.sharpness;
+
+    vec3 colour = (lobe * (b + d + f + h) + e) / (4.0 * lobe + 1.0);
+    imageStore(destination, pixel, vec4(clamp(colour, 0.0, 1.0), 1.0));
+}
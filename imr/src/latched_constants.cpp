@@ -0,0 +1,100 @@
+#include "imr_private.h"
+
+#include <cstring>
+
+namespace imr {
+
+struct LatchedCopy {
+    Device& device;
+    Buffer buffer;
+    void* mapped;
+    /// Set by the host once the values are in, for copies the GPU was told to wait for
+    VkEvent latched_event;
+    bool in_use = false;
+    bool deferred = false;
+    bool latched = false;
+
+    LatchedCopy(Device& device, size_t size) : device(device), buffer(device, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+        mapped = buffer.map();
+        CHECK_VK_THROW(vkCreateEvent(device.device, tmpPtr((VkEventCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO,
+        }), nullptr, &latched_event));
+    }
+
+    ~LatchedCopy() {
+        vkDestroyEvent(device.device, latched_event, nullptr);
+        buffer.unmap();
+    }
+};
+
+struct LatchedConstants::Impl {
+    Device& device;
+    size_t size;
+    /// Shared with the cleanup actions of the frames using them, which may outlive this
+    std::vector<std::shared_ptr<LatchedCopy>> copies;
+    std::shared_ptr<LatchedCopy> current;
+};
+
+LatchedConstants::LatchedConstants(Device& device, size_t size) {
+    _impl = std::make_unique<Impl>(device, size);
+}
+
+LatchedConstants::~LatchedConstants() {
+    // don't leave the GPU waiting on a copy nobody will latch anymore
+    if (_impl->current && _impl->current->deferred && !_impl->current->latched)
+        CHECK_VK_THROW(vkSetEvent(_impl->device.device, _impl->current->latched_event));
+}
+
+VkDeviceAddress LatchedConstants::begin_frame(Swapchain::Frame& frame) {
+    auto& device = _impl->device;
+    if (_impl->current && _impl->current->deferred && !_impl->current->latched)
+        latch(_impl->current->mapped);
+
+    std::shared_ptr<LatchedCopy> copy;
+    for (auto& candidate : _impl->copies) {
+        if (!candidate->in_use) {
+            copy = candidate;
+            break;
+        }
+    }
+    // as many copies as there are frames in flight
+    if (!copy) {
+        copy = std::make_shared<LatchedCopy>(device, _impl->size);
+        _impl->copies.push_back(copy);
+    }
+
+    copy->in_use = true;
+    copy->deferred = false;
+    copy->latched = false;
+    // nothing in flight waits on it anymore
+    CHECK_VK_THROW(vkResetEvent(device.device, copy->latched_event));
+    frame.addCleanupAction([copy]() {
+        copy->in_use = false;
+    });
+    _impl->current = copy;
+    return copy->buffer.device_address();
+}
+
+void LatchedConstants::defer(VkCommandBuffer cmdbuf) {
+    auto& copy = *_impl->current;
+    assert(!copy.latched && "defer() has to come before latch()");
+    copy.deferred = true;
+    // the host writes before vkSetEvent become visible through this wait
+    vkCmdWaitEvents(cmdbuf, 1, &copy.latched_event, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 1, tmpPtr((VkMemoryBarrier) {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_HOST_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+    }), 0, nullptr, 0, nullptr);
+}
+
+void LatchedConstants::latch(const void* data) {
+    auto& copy = *_impl->current;
+    assert(!copy.latched && "latch() was already called for this frame");
+    if (data != copy.mapped)
+        memcpy(copy.mapped, data, _impl->size);
+    copy.latched = true;
+    if (copy.deferred)
+        CHECK_VK_THROW(vkSetEvent(_impl->device.device, copy.latched_event));
+}
+
+}
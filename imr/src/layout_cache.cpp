@@ -0,0 +1,137 @@
+#include "imr_private.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace imr {
+
+static void hash_mix(size_t& h, size_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+}
+
+bool LayoutCache::SetLayoutKey::operator==(const SetLayoutKey& other) const {
+    if (bindings.size() != other.bindings.size() || flags != other.flags || create_flags != other.create_flags)
+        return false;
+    for (size_t i = 0; i < bindings.size(); i++) {
+        auto& a = bindings[i];
+        auto& b = other.bindings[i];
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags)
+            return false;
+    }
+    return true;
+}
+
+bool LayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const {
+    if (set_layouts != other.set_layouts || push_constants.size() != other.push_constants.size())
+        return false;
+    for (size_t i = 0; i < push_constants.size(); i++) {
+        auto& a = push_constants[i];
+        auto& b = other.push_constants[i];
+        if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size)
+            return false;
+    }
+    return true;
+}
+
+size_t LayoutCache::Hash::operator()(const SetLayoutKey& key) const {
+    size_t h = key.create_flags;
+    for (auto& binding : key.bindings) {
+        hash_mix(h, binding.binding);
+        hash_mix(h, binding.descriptorType);
+        hash_mix(h, binding.descriptorCount);
+        hash_mix(h, binding.stageFlags);
+    }
+    for (auto flags : key.flags)
+        hash_mix(h, flags);
+    return h;
+}
+
+size_t LayoutCache::Hash::operator()(const PipelineLayoutKey& key) const {
+    size_t h = 0;
+    for (auto set_layout : key.set_layouts)
+        hash_mix(h, (size_t) set_layout);
+    for (auto& range : key.push_constants) {
+        hash_mix(h, range.stageFlags);
+        hash_mix(h, range.offset);
+        hash_mix(h, range.size);
+    }
+    return h;
+}
+
+VkDescriptorSetLayout LayoutCache::get_set_layout(Device& device, std::vector<VkDescriptorSetLayoutBinding> bindings, const std::vector<VkDescriptorBindingFlags>& flags, VkDescriptorSetLayoutCreateFlags create_flags) {
+    assert(flags.empty() || flags.size() == bindings.size());
+
+    // reflection does not guarantee any particular order, so normalize it
+    std::vector<size_t> order(bindings.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return bindings[a].binding < bindings[b].binding; });
+
+    SetLayoutKey key { .create_flags = create_flags };
+    for (auto i : order) {
+        auto binding = bindings[i];
+        if (binding.pImmutableSamplers)
+            throw std::runtime_error("Immutable samplers are not supported by the layout cache");
+        key.bindings.push_back(binding);
+        if (!flags.empty())
+            key.flags.push_back(flags[i]);
+    }
+    // all-zero flags are the same as no flags at all
+    if (std::all_of(key.flags.begin(), key.flags.end(), [](auto f) { return f == 0; }))
+        key.flags.clear();
+
+    if (auto found = set_layouts.find(key); found != set_layouts.end())
+        return found->second;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flags_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(key.flags.size()),
+        .pBindingFlags = key.flags.data(),
+    };
+
+    VkDescriptorSetLayout layout;
+    CHECK_VK_THROW(vkCreateDescriptorSetLayout(device.device, tmpPtr((VkDescriptorSetLayoutCreateInfo) {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = key.flags.empty() ? nullptr : &flags_create_info,
+        .flags = create_flags,
+        .bindingCount = static_cast<uint32_t>(key.bindings.size()),
+        .pBindings = key.bindings.data(),
+    }), nullptr, &layout));
+
+    set_layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+VkPipelineLayout LayoutCache::get_pipeline_layout(Device& device, const std::vector<VkDescriptorSetLayout>& sets, const std::vector<VkPushConstantRange>& push_constants) {
+    PipelineLayoutKey key { sets, push_constants };
+    // pipelines only differing in how much of the push constants they use can share a layout if it declares the guaranteed minimum of 128 bytes
+    // with several ranges, widening one could overlap another and change which stage flags vkCmdPushConstants needs, so those stay as they are
+    if (key.push_constants.size() == 1 && key.push_constants[0].offset + key.push_constants[0].size <= min_push_constants_size) {
+        key.push_constants[0].offset = 0;
+        key.push_constants[0].size = min_push_constants_size;
+    }
+    if (auto found = pipeline_layouts.find(key); found != pipeline_layouts.end())
+        return found->second;
+
+    VkPipelineLayout layout;
+    CHECK_VK_THROW(vkCreatePipelineLayout(device.device, tmpPtr((VkPipelineLayoutCreateInfo) {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = static_cast<uint32_t>(sets.size()),
+        .pSetLayouts = sets.data(),
+        .pushConstantRangeCount = static_cast<uint32_t>(key.push_constants.size()),
+        .pPushConstantRanges = key.push_constants.data()
+    }), nullptr, &layout));
+
+    pipeline_layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+void LayoutCache::destroy(Device& device) {
+    for (auto& [key, layout] : pipeline_layouts)
+        vkDestroyPipelineLayout(device.device, layout, nullptr);
+    pipeline_layouts.clear();
+    for (auto& [key, layout] : set_layouts)
+        vkDestroyDescriptorSetLayout(device.device, layout, nullptr);
+    set_layouts.clear();
+}
+
+}
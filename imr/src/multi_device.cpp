@@ -0,0 +1,592 @@
+#include "swapchain_private.h"
+
+#include "imr/util.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <limits>
+
+namespace imr {
+
+/// Weight of the newest measurement in the frame time averages
+static constexpr double frame_time_smoothing = 0.1;
+
+struct MultiDeviceRenderer::RenderContext::Impl {
+    std::vector<std::function<void(void)>>& cleanup_queue;
+};
+
+void MultiDeviceRenderer::RenderContext::addCleanupAction(std::function<void(void)>&& fn) {
+    _impl->cleanup_queue.push_back(std::move(fn));
+}
+
+/// Host-visible copy of a lane's target, for devices that don't present
+struct ReadbackSlot {
+    std::unique_ptr<Buffer> buffer;
+    /// The same host memory imported into the presenting device, when both can import host memory. Uploads then read it directly instead of copying it first.
+    std::unique_ptr<Buffer> shared;
+    void* host_memory = nullptr;
+    uint8_t* mapped = nullptr;
+
+    void allocate(Device& device, Device& presenting_device, size_t bytes) {
+        if (device.features().external_memory_host && presenting_device.features().external_memory_host) {
+            size_t alignment = std::max(device.host_import_alignment(), presenting_device.host_import_alignment());
+            size_t size = (bytes + alignment - 1) / alignment * alignment;
+            host_memory = std::aligned_alloc(alignment, size);
+            try {
+                buffer = std::make_unique<Buffer>(device, host_memory, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+                shared = std::make_unique<Buffer>(presenting_device, host_memory, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+                mapped = static_cast<uint8_t*>(host_memory);
+                return;
+            } catch (std::runtime_error&) {
+                // not every driver takes the same pointer twice, fall back to copying
+                release();
+            }
+        }
+        buffer = std::make_unique<Buffer>(device, bytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        mapped = static_cast<uint8_t*>(buffer->map());
+    }
+
+    void release() {
+        if (buffer && !host_memory)
+            buffer->unmap();
+        shared.reset();
+        buffer.reset();
+        std::free(host_memory);
+        host_memory = nullptr;
+        mapped = nullptr;
+    }
+};
+
+/// Everything one device needs to render its share of frames
+struct RenderLane {
+    Device& device;
+    Device& presenting_device;
+    bool presenting;
+
+    std::unique_ptr<Image> target;
+    /// Alternating per recorded frame, so the presenting device can still be uploading one while the next is written
+    ReadbackSlot readback[2];
+    uint32_t readback_slot = 0;
+
+    VkQueryPool timestamps;
+    VkFence render_done;
+    /// Presenting device only: signalled once the swapchain is done reading `target`
+    VkFence present_done;
+    VkCommandBuffer cmdbuf = VK_NULL_HANDLE;
+    std::vector<std::function<void(void)>> cleanup_queue;
+
+    std::optional<size_t> in_flight;
+    uint64_t submitted_at = 0;
+    double frame_time_ms = 0;
+    VkRect2D region = {};
+
+    RenderLane(Device& device, Device& presenting_device, bool presenting) : device(device), presenting_device(presenting_device), presenting(presenting) {
+        CHECK_VK_THROW(vkCreateQueryPool(device.device, tmpPtr((VkQueryPoolCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = 2,
+        }), nullptr, &timestamps));
+        CHECK_VK_THROW(vkCreateFence(device.device, tmpPtr((VkFenceCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        }), nullptr, &render_done));
+        CHECK_VK_THROW(vkCreateFence(device.device, tmpPtr((VkFenceCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+        }), nullptr, &present_done));
+    }
+
+    bool target_matches(VkExtent2D extent, VkFormat format) const {
+        return target && target->size().width == extent.width && target->size().height == extent.height && target->format() == format;
+    }
+
+    /// The presenting device must be done uploading from the readback slots
+    void ensure_target(VkExtent2D extent, VkFormat format) {
+        if (target_matches(extent, format))
+            return;
+        CHECK_VK_THROW(vkWaitForFences(device.device, 1, &present_done, true, UINT64_MAX));
+        for (auto& slot : readback)
+            slot.release();
+        target = std::make_unique<Image>(device, VK_IMAGE_TYPE_2D, (VkExtent3D) { extent.width, extent.height, 1 }, format, static_cast<VkImageUsageFlagBits>(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+        if (!presenting) {
+            for (auto& slot : readback)
+                slot.allocate(device, presenting_device, size_t(extent.width) * extent.height * format_info(format).block_size);
+        }
+    }
+
+    VkDeviceSize row_offset(int32_t y) const {
+        return VkDeviceSize(y) * target->size().width * format_info(target->format()).block_size;
+    }
+
+    void record(std::function<void(MultiDeviceRenderer::RenderContext&)>& fn, VkRect2D region, size_t frame_id) {
+        auto& vk = device.dispatch;
+        assert(!in_flight);
+        // the swapchain might still be blitting the previous frame out of the target
+        if (presenting)
+            CHECK_VK_THROW(vkWaitForFences(device.device, 1, &present_done, true, UINT64_MAX));
+
+        CHECK_VK_THROW(vkAllocateCommandBuffers(device.device, tmpPtr((VkCommandBufferAllocateInfo) {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = device.pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        }), &cmdbuf));
+        CHECK_VK_THROW(vkBeginCommandBuffer(cmdbuf, tmpPtr((VkCommandBufferBeginInfo) {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        })));
+
+        bool has_timestamps = device._impl->has_timestamps;
+        if (has_timestamps)
+            vkCmdResetQueryPool(cmdbuf, timestamps, 0, 2);
+        vk.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .imageMemoryBarrierCount = 1,
+            .pImageMemoryBarriers = tmpPtr((VkImageMemoryBarrier2) {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+                .srcAccessMask = VK_ACCESS_2_NONE,
+                .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+                .image = target->handle(),
+                .subresourceRange = target->whole_image_subresource_range(),
+            }),
+        }));
+        if (has_timestamps)
+            vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestamps, 0);
+
+        MultiDeviceRenderer::RenderContext::Impl context_impl { cleanup_queue };
+        MultiDeviceRenderer::RenderContext context { device, cmdbuf, *target, region, frame_id, &context_impl };
+        fn(context);
+
+        vk.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = tmpPtr((VkMemoryBarrier2) {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                .srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+            }),
+        }));
+        if (!presenting) {
+            readback_slot ^= 1;
+            vkCmdCopyImageToBuffer(cmdbuf, target->handle(), VK_IMAGE_LAYOUT_GENERAL, readback[readback_slot].buffer->handle, 1, tmpPtr((VkBufferImageCopy) {
+                .bufferOffset = row_offset(region.offset.y),
+                .bufferRowLength = target->size().width,
+                .imageSubresource = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .layerCount = 1,
+                },
+                .imageOffset = { 0, region.offset.y, 0 },
+                .imageExtent = { target->size().width, region.extent.height, 1 },
+            }));
+            // the fence alone doesn't make the copy visible to the host, which reads it in upload_region()
+            vk.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
+                .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                .memoryBarrierCount = 1,
+                .pMemoryBarriers = tmpPtr((VkMemoryBarrier2) {
+                    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                    .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                    .dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+                    .dstAccessMask = VK_ACCESS_2_HOST_READ_BIT,
+                }),
+            }));
+        }
+        if (has_timestamps)
+            vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps, 1);
+
+        CHECK_VK_THROW(vkEndCommandBuffer(cmdbuf));
+        CHECK_VK_THROW(device.submit((VkSubmitInfo) {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &cmdbuf,
+        }, render_done));
+
+        this->region = region;
+        in_flight = frame_id;
+        submitted_at = imr_get_time_nano();
+    }
+
+    bool done() const {
+        return !in_flight || vkGetFenceStatus(device.device, render_done) == VK_SUCCESS;
+    }
+
+    /// Waits for the frame in flight, updates the timings and runs the cleanup actions
+    void retire() {
+        if (!in_flight)
+            return;
+        CHECK_VK_THROW(vkWaitForFences(device.device, 1, &render_done, true, UINT64_MAX));
+        CHECK_VK_THROW(vkResetFences(device.device, 1, &render_done));
+
+        uint64_t ticks[2];
+        std::optional<double> ms;
+        if (!device._impl->has_timestamps)
+            // without timestamps, the time since submission is an upper bound
+            ms = double(imr_get_time_nano() - submitted_at) / 1000000.0;
+        else if (vkGetQueryPoolResults(device.device, timestamps, 0, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+            ms = timestamp_ms(device, ticks[0], ticks[1]);
+        if (ms)
+            frame_time_ms = frame_time_ms == 0 ? *ms : frame_time_ms + (*ms - frame_time_ms) * frame_time_smoothing;
+
+        for (auto& fn : cleanup_queue)
+            fn();
+        cleanup_queue.clear();
+        vkFreeCommandBuffers(device.device, device.pool, 1, &cmdbuf);
+        cmdbuf = VK_NULL_HANDLE;
+        in_flight.reset();
+    }
+
+    /// When this lane would be done with one more frame, if started as soon as it's free
+    double estimated_finish_ms(uint64_t now) const {
+        double remaining = 0;
+        if (in_flight)
+            remaining = std::max(0.0, frame_time_ms - double(now - submitted_at) / 1000000.0);
+        return remaining + frame_time_ms;
+    }
+
+    ~RenderLane() {
+        retire();
+        vkWaitForFences(device.device, 1, &present_done, true, UINT64_MAX);
+        for (auto& slot : readback)
+            slot.release();
+        vkDestroyFence(device.device, present_done, nullptr);
+        vkDestroyFence(device.device, render_done, nullptr);
+        vkDestroyQueryPool(device.device, timestamps, nullptr);
+    }
+};
+
+struct MultiDeviceRenderer::Impl {
+    Swapchain& swapchain;
+    Device& device;
+    Mode mode;
+    std::vector<std::unique_ptr<RenderLane>> lanes;
+    RenderLane* presenting = nullptr;
+    size_t frame_counter = 0;
+
+    /// Alternate frame: lanes with a frame in flight, oldest frame first
+    std::deque<RenderLane*> in_flight;
+    /// Split frame: the lanes rendering the frame that renderFrame() presents next time, empty lanes sit it out
+    std::vector<RenderLane*> split_pending;
+
+    /// Results from other devices get copied here when their readback memory isn't shared with this device, then into `composite` (alternate frame) or the presenting lane's target (split frame)
+    std::unique_ptr<Buffer> upload;
+    uint8_t* upload_mapped = nullptr;
+    /// Signalled once the upload command buffer is done with `upload`
+    VkFence upload_reusable;
+    std::unique_ptr<Image> composite;
+    /// Signalled once the swapchain is done reading `composite`
+    VkFence composite_reusable;
+    VkSemaphore upload_done;
+    VkCommandBuffer upload_cmdbuf = VK_NULL_HANDLE;
+
+    Impl(Swapchain& swapchain, Mode mode) : swapchain(swapchain), device(swapchain.device()), mode(mode) {
+        CHECK_VK_THROW(vkCreateFence(device.device, tmpPtr((VkFenceCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+        }), nullptr, &upload_reusable));
+        CHECK_VK_THROW(vkCreateFence(device.device, tmpPtr((VkFenceCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+        }), nullptr, &composite_reusable));
+        CHECK_VK_THROW(vkCreateSemaphore(device.device, tmpPtr((VkSemaphoreCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        }), nullptr, &upload_done));
+    }
+
+    VkExtent2D extent() const { return swapchain._impl->swapchain.extent; }
+
+    void prepare_lane(RenderLane& lane, VkExtent2D size, VkFormat format) {
+        // the last upload may still be reading the lane's readback slots
+        if (!lane.target_matches(size, format))
+            CHECK_VK_THROW(vkWaitForFences(device.device, 1, &upload_reusable, true, UINT64_MAX));
+        lane.ensure_target(size, format);
+    }
+
+    /// Waits until the previous upload has been copied out, and makes room for a frame of this size
+    void begin_upload(VkExtent2D size, VkFormat format) {
+        CHECK_VK_THROW(vkWaitForFences(device.device, 1, &upload_reusable, true, UINT64_MAX));
+        CHECK_VK_THROW(vkResetFences(device.device, 1, &upload_reusable));
+
+        size_t bytes = size_t(size.width) * size.height * format_info(format).block_size;
+        if (!upload || upload->size < bytes) {
+            if (upload)
+                upload->unmap();
+            upload = std::make_unique<Buffer>(device, bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            upload_mapped = static_cast<uint8_t*>(upload->map());
+        }
+        if (upload_cmdbuf)
+            vkFreeCommandBuffers(device.device, device.pool, 1, &upload_cmdbuf);
+        if (mode == Mode::AlternateFrame && (!composite || composite->size().width != size.width || composite->size().height != size.height || composite->format() != format))
+            composite = std::make_unique<Image>(device, VK_IMAGE_TYPE_2D, (VkExtent3D) { size.width, size.height, 1 }, format, static_cast<VkImageUsageFlagBits>(VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT));
+
+        CHECK_VK_THROW(vkAllocateCommandBuffers(device.device, tmpPtr((VkCommandBufferAllocateInfo) {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = device.pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        }), &upload_cmdbuf));
+        CHECK_VK_THROW(vkBeginCommandBuffer(upload_cmdbuf, tmpPtr((VkCommandBufferBeginInfo) {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        })));
+    }
+
+    /// Copies the rows of `lane`'s last region from its readback buffer to `dst`, which is in VK_IMAGE_LAYOUT_GENERAL or TRANSFER_DST_OPTIMAL
+    void upload_region(RenderLane& lane, Image& dst, VkImageLayout dst_layout) {
+        auto& slot = lane.readback[lane.readback_slot];
+        VkDeviceSize offset = lane.row_offset(lane.region.offset.y);
+        VkBuffer source = slot.shared ? slot.shared->handle : upload->handle;
+        if (!slot.shared)
+            memcpy(upload_mapped + offset, slot.mapped + offset, lane.row_offset(lane.region.extent.height));
+        vkCmdCopyBufferToImage(upload_cmdbuf, source, dst.handle(), dst_layout, 1, tmpPtr((VkBufferImageCopy) {
+            .bufferOffset = offset,
+            .bufferRowLength = lane.target->size().width,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .layerCount = 1,
+            },
+            .imageOffset = { 0, lane.region.offset.y, 0 },
+            .imageExtent = { lane.target->size().width, lane.region.extent.height, 1 },
+        }));
+    }
+
+    /// Submits the upload, the swapchain blit has to wait on `upload_done`
+    void end_upload(VkImage image, VkImageLayout layout) {
+        device.dispatch.cmdPipelineBarrier2KHR(upload_cmdbuf, tmpPtr((VkDependencyInfo) {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .imageMemoryBarrierCount = 1,
+            .pImageMemoryBarriers = tmpPtr((VkImageMemoryBarrier2) {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                .dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+                .oldLayout = layout,
+                .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+                .image = image,
+                .subresourceRange = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .levelCount = 1,
+                    .layerCount = 1,
+                },
+            }),
+        }));
+        CHECK_VK_THROW(vkEndCommandBuffer(upload_cmdbuf));
+        CHECK_VK_THROW(device.submit((VkSubmitInfo) {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &upload_cmdbuf,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &upload_done,
+        }, upload_reusable));
+    }
+
+    void present_lane_target(RenderLane& lane, std::optional<VkSemaphore> wait) {
+        CHECK_VK_THROW(vkResetFences(device.device, 1, &lane.present_done));
+        VkExtent2D size = { lane.target->size().width, lane.target->size().height };
+        swapchain.beginFrame([&](Swapchain::Frame& frame) {
+            frame.presentFromImage(lane.target->handle(), lane.present_done, wait, VK_IMAGE_LAYOUT_GENERAL, size);
+        });
+    }
+
+    /// Alternate frame: shows the frame `lane` just finished
+    void present(RenderLane& lane) {
+        if (lane.presenting) {
+            CHECK_VK_THROW(vkWaitForFences(device.device, 1, &lane.present_done, true, UINT64_MAX));
+            present_lane_target(lane, std::nullopt);
+            return;
+        }
+
+        VkExtent2D size = { lane.target->size().width, lane.target->size().height };
+        CHECK_VK_THROW(vkWaitForFences(device.device, 1, &composite_reusable, true, UINT64_MAX));
+        CHECK_VK_THROW(vkResetFences(device.device, 1, &composite_reusable));
+        begin_upload(size, lane.target->format());
+        device.dispatch.cmdPipelineBarrier2KHR(upload_cmdbuf, tmpPtr((VkDependencyInfo) {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .imageMemoryBarrierCount = 1,
+            .pImageMemoryBarriers = tmpPtr((VkImageMemoryBarrier2) {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+                .srcAccessMask = VK_ACCESS_2_NONE,
+                .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .image = composite->handle(),
+                .subresourceRange = composite->whole_image_subresource_range(),
+            }),
+        }));
+        upload_region(lane, *composite, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        end_upload(composite->handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+        swapchain.beginFrame([&](Swapchain::Frame& frame) {
+            frame.presentFromImage(composite->handle(), composite_reusable, upload_done, VK_IMAGE_LAYOUT_GENERAL, size);
+        });
+    }
+
+    void retire_oldest() {
+        RenderLane* lane = in_flight.front();
+        in_flight.pop_front();
+        lane->retire();
+        present(*lane);
+    }
+
+    void render_alternate(std::function<void(RenderContext&)>& fn) {
+        // pick whichever device would be done with this frame first, unmeasured ones get a go first
+        uint64_t now = imr_get_time_nano();
+        RenderLane* chosen = nullptr;
+        double best = std::numeric_limits<double>::infinity();
+        for (auto& lane : lanes) {
+            double finish = lane->estimated_finish_ms(now);
+            if (finish < best || (finish == best && !lane->in_flight)) {
+                best = finish;
+                chosen = lane.get();
+            }
+        }
+
+        // frames are shown in order, so everything submitted before the chosen device's frame has to go first
+        while (chosen->in_flight)
+            retire_oldest();
+
+        VkExtent2D size = extent();
+        prepare_lane(*chosen, size, swapchain.format());
+        chosen->record(fn, { { 0, 0 }, size }, frame_counter++);
+        in_flight.push_back(chosen);
+
+        while (!in_flight.empty() && in_flight.front()->done())
+            retire_oldest();
+    }
+
+    /// Split frame: waits for the lanes of the pending frame, brings their bands over to the presenting device and presents it
+    void present_split() {
+        if (split_pending.empty())
+            return;
+        for (auto lane : split_pending)
+            lane->retire();
+
+        // the presenting lane's target holds its own band, and the other ones get copied around it once the swapchain is done with the previous frame
+        auto& target = *presenting->target;
+        CHECK_VK_THROW(vkWaitForFences(device.device, 1, &presenting->present_done, true, UINT64_MAX));
+        begin_upload({ target.size().width, target.size().height }, target.format());
+        for (auto lane : split_pending) {
+            if (!lane->presenting)
+                upload_region(*lane, target, VK_IMAGE_LAYOUT_GENERAL);
+        }
+        end_upload(target.handle(), VK_IMAGE_LAYOUT_GENERAL);
+        split_pending.clear();
+
+        present_lane_target(*presenting, upload_done);
+    }
+
+    void render_split(std::function<void(RenderContext&)>& fn) {
+        VkExtent2D size = extent();
+        VkFormat format = swapchain.format();
+
+        // band heights follow the rows per millisecond each device managed last time
+        std::vector<double> weights;
+        bool measured = true;
+        for (auto& lane : lanes) {
+            measured &= lane->frame_time_ms > 0 && lane->region.extent.height > 0;
+            weights.push_back(measured ? lane->region.extent.height / lane->frame_time_ms : 1.0);
+        }
+        if (!measured)
+            std::fill(weights.begin(), weights.end(), 1.0);
+        double total_weight = 0;
+        for (auto w : weights)
+            total_weight += w;
+
+        std::vector<uint32_t> rows(lanes.size());
+        uint32_t assigned = 0;
+        for (size_t i = 0; i + 1 < lanes.size(); i++) {
+            rows[i] = std::min(size.height - assigned, uint32_t(size.height * weights[i] / total_weight));
+            assigned += rows[i];
+        }
+        rows.back() = size.height - assigned;
+        // keep every device in the loop so its speed stays measured, as long as there are rows to spare
+        for (auto& r : rows) {
+            if (r > 0)
+                continue;
+            auto largest = std::max_element(rows.begin(), rows.end());
+            if (*largest < 2)
+                break;
+            (*largest)--;
+            r = 1;
+        }
+
+        // the previous frame went on in the background, while the application prepared this one
+        present_split();
+
+        // the bands are composited in the presenting lane's target, even when it has none of its own
+        prepare_lane(*presenting, size, format);
+
+        size_t frame_id = frame_counter++;
+        std::vector<uint32_t> tops(lanes.size());
+        for (size_t i = 1; i < lanes.size(); i++)
+            tops[i] = tops[i - 1] + rows[i - 1];
+        // the other devices go first, so they get going while the presenting one may still be blitting
+        for (bool presenting_pass : { false, true }) {
+            for (size_t i = 0; i < lanes.size(); i++) {
+                auto& lane = *lanes[i];
+                if (rows[i] == 0 || lane.presenting != presenting_pass)
+                    continue;
+                prepare_lane(lane, size, format);
+                lane.record(fn, { { 0, int32_t(tops[i]) }, { size.width, rows[i] } }, frame_id);
+                split_pending.push_back(&lane);
+            }
+        }
+    }
+};
+
+MultiDeviceRenderer::MultiDeviceRenderer(Swapchain& swapchain, std::vector<Device*> devices, Mode mode) {
+    _impl = std::make_unique<Impl>(swapchain, mode);
+    for (auto device : devices) {
+        bool presenting = device == &swapchain.device();
+        _impl->lanes.push_back(std::make_unique<RenderLane>(*device, swapchain.device(), presenting));
+        if (presenting)
+            _impl->presenting = _impl->lanes.back().get();
+    }
+    if (!_impl->presenting)
+        throw std::runtime_error("The swapchain's device has to be one of the devices used by MultiDeviceRenderer");
+}
+
+void MultiDeviceRenderer::renderFrame(std::function<void(RenderContext&)>&& fn) {
+    if (_impl->mode == Mode::AlternateFrame)
+        _impl->render_alternate(fn);
+    else
+        _impl->render_split(fn);
+}
+
+std::vector<double> MultiDeviceRenderer::device_frame_times() const {
+    std::vector<double> times;
+    for (auto& lane : _impl->lanes)
+        times.push_back(lane->frame_time_ms);
+    return times;
+}
+
+void MultiDeviceRenderer::drain() {
+    while (!_impl->in_flight.empty())
+        _impl->retire_oldest();
+    _impl->present_split();
+    _impl->swapchain.drain();
+}
+
+MultiDeviceRenderer::~MultiDeviceRenderer() {
+    drain();
+    auto& device = _impl->device;
+    vkWaitForFences(device.device, 1, &_impl->upload_reusable, true, UINT64_MAX);
+    vkWaitForFences(device.device, 1, &_impl->composite_reusable, true, UINT64_MAX);
+    if (_impl->upload_cmdbuf)
+        vkFreeCommandBuffers(device.device, device.pool, 1, &_impl->upload_cmdbuf);
+    if (_impl->upload)
+        _impl->upload->unmap();
+    vkDestroySemaphore(device.device, _impl->upload_done, nullptr);
+    vkDestroyFence(device.device, _impl->upload_reusable, nullptr);
+    vkDestroyFence(device.device, _impl->composite_reusable, nullptr);
+}
+
+}
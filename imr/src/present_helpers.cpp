@@ -28,6 +28,9 @@ void Swapchain::Frame::presentFromBuffer(VkBuffer buffer, VkFence signal_when_re
         .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
     })));
 
+    // the image keeps an earlier frame unless we have to copy all of it anyway
+    auto refresh = _impl->regions_to_refresh();
+
     vk.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
         .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
         .dependencyFlags = 0,
@@ -38,7 +41,7 @@ void Swapchain::Frame::presentFromBuffer(VkBuffer buffer, VkFence signal_when_re
             .srcAccessMask = VK_ACCESS_2_NONE,
             .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
             .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
-            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .oldLayout = refresh ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_UNDEFINED,
             .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             .image = slot.image,
             .subresourceRange = {
@@ -49,17 +52,21 @@ void Swapchain::Frame::presentFromBuffer(VkBuffer buffer, VkFence signal_when_re
         }),
     }));
     VkExtent2D src_size = swapchain._impl->swapchain.extent;
-    vkCmdCopyBufferToImage(cmdbuf, buffer, slot.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, tmpPtr((VkBufferImageCopy) {
-        .imageSubresource = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .layerCount = 1,
-        },
-        .imageExtent = {
-            .width = swapchain._impl->swapchain.extent.width,
-            .height = swapchain._impl->swapchain.extent.height,
-            .depth = 1
-        }
-    }));
+    // the buffer always holds the whole frame, tightly packed
+    std::vector<VkBufferImageCopy> copies;
+    for (auto& region : refresh.value_or(std::vector<VkRect2D> { { {}, src_size } })) {
+        copies.push_back({
+            .bufferOffset = (size_t(region.offset.y) * src_size.width + region.offset.x) * format_info(swapchain.format()).block_size,
+            .bufferRowLength = src_size.width,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .layerCount = 1,
+            },
+            .imageOffset = { region.offset.x, region.offset.y, 0 },
+            .imageExtent = { region.extent.width, region.extent.height, 1 },
+        });
+    }
+    vkCmdCopyBufferToImage(cmdbuf, buffer, slot.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copies.size()), copies.data());
     vk.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
         .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
         .dependencyFlags = 0,
@@ -86,7 +93,7 @@ void Swapchain::Frame::presentFromBuffer(VkBuffer buffer, VkFence signal_when_re
         stage_flags.emplace_back(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
 
     vkEndCommandBuffer(cmdbuf);
-    vkQueueSubmit(device.main_queue, 1, tmpPtr((VkSubmitInfo) {
+    device.enqueueSubmit((VkSubmitInfo) {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
         .waitSemaphoreCount = static_cast<uint32_t>(semaphores.size()),
         .pWaitSemaphores = semaphores.data(),
@@ -95,7 +102,7 @@ void Swapchain::Frame::presentFromBuffer(VkBuffer buffer, VkFence signal_when_re
         .pCommandBuffers = &cmdbuf,
         .signalSemaphoreCount = 1,
         .pSignalSemaphores = &slot.present_semaphore,
-    }), signal_when_reusable);
+    }, signal_when_reusable);
 
     addCleanupAction([=, &device]() {
         vkFreeCommandBuffers(device.device, device.pool, 1, &cmdbuf);
@@ -208,7 +215,7 @@ void Swapchain::Frame::presentFromImage(VkImage image, VkFence signal_when_reusa
         stage_flags.emplace_back(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
 
     vkEndCommandBuffer(cmdbuf);
-    vkQueueSubmit(device.main_queue, 1, tmpPtr((VkSubmitInfo) {
+    device.enqueueSubmit((VkSubmitInfo) {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
         .waitSemaphoreCount = static_cast<uint32_t>(semaphores.size()),
         .pWaitSemaphores = semaphores.data(),
@@ -217,7 +224,7 @@ void Swapchain::Frame::presentFromImage(VkImage image, VkFence signal_when_reusa
         .pCommandBuffers = &cmdbuf,
         .signalSemaphoreCount = 1,
         .pSignalSemaphores = &slot.present_semaphore,
-    }), signal_when_reusable);
+    }, signal_when_reusable);
 
     addCleanupAction([=, &device]() {
         vkFreeCommandBuffers(device.device, device.pool, 1, &cmdbuf);
@@ -0,0 +1,68 @@
+#include "swapchain_private.h"
+
+namespace imr {
+
+PresentThread::PresentThread(Swapchain::Impl& swapchain) : swapchain(swapchain) {
+    thread = std::thread([this]() { run(); });
+}
+
+PresentThread::~PresentThread() {
+    push({ .quit = true });
+    thread.join();
+}
+
+void PresentThread::push(PresentRequest&& request) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    while (t - h == capacity) {
+        head.wait(h, std::memory_order_acquire);
+        h = head.load(std::memory_order_acquire);
+    }
+    ring[t % capacity] = std::move(request);
+    tail.store(t + 1, std::memory_order_release);
+    tail.notify_one();
+}
+
+void PresentThread::wait_idle() {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    while (h != t) {
+        head.wait(h, std::memory_order_acquire);
+        h = head.load(std::memory_order_acquire);
+    }
+}
+
+void PresentThread::run() {
+    while (true) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        if (h == t) {
+            tail.wait(t, std::memory_order_acquire);
+            continue;
+        }
+
+        auto& request = ring[h % capacity];
+        bool quit = request.quit;
+        if (!quit) {
+            VkResult result = swapchain.present(request);
+            switch (result) {
+                case VK_SUCCESS: break;
+                // the next acquire notices too, but this saves presenting a few more frames at the wrong size
+                case VK_SUBOPTIMAL_KHR:
+                case VK_ERROR_OUT_OF_DATE_KHR: swapchain.should_resize = true; break;
+                default: {
+                    VkResult expected = VK_SUCCESS;
+                    error.compare_exchange_strong(expected, result);
+                }
+            }
+            request.rects.clear();
+        }
+
+        head.store(h + 1, std::memory_order_release);
+        head.notify_all();
+        if (quit)
+            return;
+    }
+}
+
+}
@@ -98,7 +98,7 @@ void Swapchain::renderFrameSimplified(std::function<void(SimplifiedRenderContext
         // before: wait on the swapchain image to be available
         // after: notify the swapchain that the image can be shown
         vkEndCommandBuffer(cmdbuf);
-        vkQueueSubmit(device.main_queue, 1, tmpPtr((VkSubmitInfo) {
+        device.enqueueSubmit((VkSubmitInfo) {
             .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
             .waitSemaphoreCount = 1,
             .pWaitSemaphores = &frame.swapchain_image_available,
@@ -107,7 +107,7 @@ void Swapchain::renderFrameSimplified(std::function<void(SimplifiedRenderContext
             .pCommandBuffers = &cmdbuf,
             .signalSemaphoreCount = 1,
             .pSignalSemaphores = &frame.signal_when_ready,
-        }), fence);
+        }, fence);
 
         // cleanup those objects once the cmdbuf has executed
         frame.addCleanupFence(fence);
@@ -0,0 +1,77 @@
+#include "imr_private.h"
+
+namespace imr {
+
+SamplerKey::SamplerKey(const VkSamplerCreateInfo& info)
+    : flags(info.flags),
+      mag_filter(info.magFilter),
+      min_filter(info.minFilter),
+      mipmap_mode(info.mipmapMode),
+      address_mode_u(info.addressModeU),
+      address_mode_v(info.addressModeV),
+      address_mode_w(info.addressModeW),
+      mip_lod_bias(info.mipLodBias),
+      anisotropy_enable(info.anisotropyEnable),
+      max_anisotropy(info.maxAnisotropy),
+      compare_enable(info.compareEnable),
+      compare_op(info.compareOp),
+      min_lod(info.minLod),
+      max_lod(info.maxLod),
+      border_color(info.borderColor),
+      unnormalized_coordinates(info.unnormalizedCoordinates) {}
+
+size_t SamplerKeyHash::operator()(const SamplerKey& key) const {
+    size_t h = 0;
+    auto mix = [&](size_t v) {
+        h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    };
+    mix(key.flags);
+    mix(key.mag_filter);
+    mix(key.min_filter);
+    mix(key.mipmap_mode);
+    mix(key.address_mode_u);
+    mix(key.address_mode_v);
+    mix(key.address_mode_w);
+    mix(std::hash<float>()(key.mip_lod_bias));
+    mix(key.anisotropy_enable);
+    mix(std::hash<float>()(key.max_anisotropy));
+    mix(key.compare_enable);
+    mix(key.compare_op);
+    mix(std::hash<float>()(key.min_lod));
+    mix(std::hash<float>()(key.max_lod));
+    mix(key.border_color);
+    mix(key.unnormalized_coordinates);
+    return h;
+}
+
+VkSampler Device::sampler(const VkSamplerCreateInfo& create_info) {
+    // extension structs (reduction modes, ycbcr conversions...) are not part of the key
+    if (create_info.pNext)
+        throw std::runtime_error("Device::sampler() does not support chained structures, create those samplers manually");
+
+    SamplerKey key(create_info);
+    if (auto found = _impl->samplers.find(key); found != _impl->samplers.end())
+        return found->second;
+
+    VkSampler sampler;
+    CHECK_VK_THROW(vkCreateSampler(device, &create_info, nullptr, &sampler));
+    _impl->samplers.emplace(key, sampler);
+    return sampler;
+}
+
+VkSamplerCreateInfo Device::linear_sampler_info(VkSamplerAddressMode address_mode) {
+    VkSamplerCreateInfo info = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+        .addressModeU = address_mode,
+        .addressModeV = address_mode,
+        .addressModeW = address_mode,
+        .maxLod = VK_LOD_CLAMP_NONE,
+        .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+    };
+    return info;
+}
+
+}
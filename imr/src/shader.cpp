@@ -13,7 +13,10 @@ extern "C" {
 
 }
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
+#include <string_view>
 
 namespace imr {
 
@@ -31,6 +34,99 @@ SPIRVModule load_spirv_module(const std::string& filename) {
     return module;
 }
 
+/// Just enough of the SPIR-V grammar to find the workgroup size
+static constexpr uint32_t spv_header_words = 5;
+static constexpr uint32_t spv_op_entry_point = 15;
+static constexpr uint32_t spv_op_execution_mode = 16;
+static constexpr uint32_t spv_op_constant = 43;
+static constexpr uint32_t spv_op_constant_composite = 44;
+static constexpr uint32_t spv_op_spec_constant = 50;
+static constexpr uint32_t spv_op_spec_constant_composite = 51;
+static constexpr uint32_t spv_op_decorate = 71;
+static constexpr uint32_t spv_execution_mode_local_size = 17;
+static constexpr uint32_t spv_decoration_builtin = 11;
+static constexpr uint32_t spv_builtin_workgroup_size = 25;
+
+std::optional<VkExtent3D> reflect_workgroup_size(const SPIRVModule& spirv_module, const std::string& entry_point) {
+    std::optional<uint32_t> entry_point_id;
+    std::unordered_map<uint32_t, VkExtent3D> local_sizes;
+    std::optional<uint32_t> builtin_id;
+    std::unordered_map<uint32_t, uint32_t> scalar_constants;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> composite_constants;
+
+    for (size_t i = spv_header_words; i < spirv_module.size();) {
+        uint32_t word_count = spirv_module[i] >> 16;
+        uint32_t opcode = spirv_module[i] & 0xFFFF;
+        if (word_count == 0 || i + word_count > spirv_module.size())
+            throw std::runtime_error("Malformed SPIR-V module");
+        const uint32_t* operands = &spirv_module[i + 1];
+        switch (opcode) {
+            case spv_op_entry_point: {
+                if (word_count < 4)
+                    break;
+                auto name = reinterpret_cast<const char*>(&operands[2]);
+                if (std::string_view(name, strnlen(name, (word_count - 3) * 4)) == entry_point)
+                    entry_point_id = operands[1];
+                break;
+            }
+            case spv_op_execution_mode:
+                if (word_count == 6 && operands[1] == spv_execution_mode_local_size)
+                    local_sizes[operands[0]] = { operands[2], operands[3], operands[4] };
+                break;
+            case spv_op_decorate:
+                if (word_count == 4 && operands[1] == spv_decoration_builtin && operands[2] == spv_builtin_workgroup_size)
+                    builtin_id = operands[0];
+                break;
+            case spv_op_constant:
+            case spv_op_spec_constant:
+                // spec constants are read with their default value
+                if (word_count == 4)
+                    scalar_constants[operands[1]] = operands[2];
+                break;
+            case spv_op_constant_composite:
+            case spv_op_spec_constant_composite:
+                // result type and id, then the constituents up to the end of the instruction
+                if (word_count >= 3)
+                    composite_constants[operands[1]] = std::vector<uint32_t>(spirv_module.begin() + i + 3, spirv_module.begin() + i + word_count);
+                break;
+            default: break;
+        }
+        i += word_count;
+    }
+
+    if (!entry_point_id)
+        throw std::runtime_error("Entry point " + entry_point + " not found in the SPIR-V module");
+
+    if (builtin_id && composite_constants.contains(*builtin_id)) {
+        auto& components = composite_constants[*builtin_id];
+        if (components.size() == 3 && std::all_of(components.begin(), components.end(), [&](uint32_t id) { return scalar_constants.contains(id); }))
+            return VkExtent3D { scalar_constants[components[0]], scalar_constants[components[1]], scalar_constants[components[2]] };
+    }
+    if (local_sizes.contains(*entry_point_id))
+        return local_sizes[*entry_point_id];
+    // LocalSizeId, or a WorkgroupSize built-in we can't evaluate
+    return std::nullopt;
+}
+
+/// SPIR-V `Dim` and `Sampled` operands of OpTypeImage
+static constexpr uint32_t spv_dim_buffer = 5;
+static constexpr uint32_t spv_image_sampled = 1;
+
+static std::optional<VkDescriptorType> image_descriptor_type(const Type* type) {
+    switch (type->tag) {
+        case SampledImageType_TAG: return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        case SamplerType_TAG: return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case ImageType_TAG: {
+            auto& image = type->payload.image_type;
+            bool sampled = image.sampled == spv_image_sampled;
+            if (image.dim == spv_dim_buffer)
+                return sampled ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+            return sampled ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        }
+        default: return std::nullopt;
+    }
+}
+
 ReflectedLayout::ReflectedLayout(imr::SPIRVModule& spirv_module, VkShaderStageFlags stage) : stages(stage) {
     auto config = shd_default_compiler_config();
     auto target = shd_default_target_config();
@@ -38,6 +134,7 @@ ReflectedLayout::ReflectedLayout(imr::SPIRVModule& spirv_module, VkShaderStageFl
     Module* module = nullptr;
     auto parse_result = shd_parse_spirv(&config, &target, spirv_module.size() * 4, reinterpret_cast<char*>(spirv_module.data()), "imr_module_name_doesnt_matter", &module);
     assert(parse_result == S2S_Success);
+    IrArena* arena = shd_module_get_arena(module);
 
     auto globals = shd_module_collect_reachable_globals(module);
     for (size_t i = 0; i < globals.count; i++) {
@@ -45,23 +142,44 @@ ReflectedLayout::ReflectedLayout(imr::SPIRVModule& spirv_module, VkShaderStageFl
         auto set = shd_lookup_annotation(def, "DescriptorSet");
         auto binding = shd_lookup_annotation(def, "Binding");
 
-        std::optional<VkDescriptorType> desc_type;
-        if (def->payload.global_variable.type->tag == ImageType_TAG)
-            desc_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        else if (def->payload.global_variable.type->tag == SampledImageType_TAG)
-            desc_type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-            // desc_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        else if (def->payload.global_variable.type->tag == SamplerType_TAG)
-            desc_type = VK_DESCRIPTOR_TYPE_SAMPLER;
-        else {
+        // descriptor arrays: unwrap the element type, a missing size means a runtime-sized array
+        const Type* type = def->payload.global_variable.type;
+        uint32_t count = 1;
+        bool runtime_sized = false;
+        if (set && binding && type->tag == ArrType_TAG) {
+            if (type->payload.arr_type.size) {
+                count = shd_get_int_value(type->payload.arr_type.size, false);
+            } else {
+                count = runtime_array_size;
+                runtime_sized = true;
+            }
+            type = type->payload.arr_type.element_type;
+        }
+
+        std::optional<VkDescriptorType> desc_type = image_descriptor_type(type);
+        if (!desc_type) {
             switch (def->payload.global_variable.address_space) {
                 case AsPushConstant: {
-                    TypeMemLayout layout = shd_get_mem_layout(shd_module_get_arena(module), def->payload.global_variable.type);
+                    // blocks can start at a non-zero offset, e.g. when stages each declare their own part of the push constants
+                    TypeMemLayout layout = shd_get_mem_layout(arena, type);
+                    uint32_t offset = 0;
+                    if (type->tag == RecordType_TAG && type->payload.record_type.members.count > 0)
+                        offset = static_cast<uint32_t>(shd_get_record_field_offset_in_bytes(arena, type, 0));
                     push_constants.push_back((VkPushConstantRange) {
                         .stageFlags = stage,
-                        .offset = 0,
-                        .size = static_cast<uint32_t>(layout.size_in_bytes),
+                        .offset = offset,
+                        .size = static_cast<uint32_t>(layout.size_in_bytes) - offset,
                     });
+                    if (type->tag == RecordType_TAG) {
+                        auto& record = type->payload.record_type;
+                        for (size_t m = 0; m < record.members.count; m++) {
+                            push_constant_members.push_back({
+                                .name = m < record.names.count ? record.names.strings[m] : "",
+                                .offset = static_cast<uint32_t>(shd_get_record_field_offset_in_bytes(arena, type, m)),
+                                .size = static_cast<uint32_t>(shd_get_mem_layout(arena, record.members.nodes[m]).size_in_bytes),
+                            });
+                        }
+                    }
                     continue;
                 }
                 case AsInput:
@@ -81,7 +199,6 @@ ReflectedLayout::ReflectedLayout(imr::SPIRVModule& spirv_module, VkShaderStageFl
             assert(binding && set);
             uint32_t seti = shd_get_int_value(shd_get_annotation_value(set), false);
             uint32_t bindingi = shd_get_int_value(shd_get_annotation_value(binding), false);
-            uint32_t count = 1;
             if (!set_bindings.contains(seti))
                 set_bindings[seti] = std::vector<VkDescriptorSetLayoutBinding>();
             set_bindings[seti].push_back((VkDescriptorSetLayoutBinding) {
@@ -90,19 +207,35 @@ ReflectedLayout::ReflectedLayout(imr::SPIRVModule& spirv_module, VkShaderStageFl
                 .descriptorCount = count,
                 .stageFlags = stage,
             });
+            if (runtime_sized)
+                binding_flags[seti][bindingi] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
         }
     }
 
-    auto a = shd_module_get_arena(module);
-    shd_destroy_ir_arena(a);
+    shd_destroy_ir_arena(arena);
 }
 
-ReflectedLayout::ReflectedLayout(imr::ReflectedLayout& a, imr::ReflectedLayout& b) : push_constants(a.push_constants), set_bindings(a.set_bindings), stages(a.stages | b.stages) {
+ReflectedLayout::ReflectedLayout(imr::ReflectedLayout& a, imr::ReflectedLayout& b) : push_constants(a.push_constants), push_constant_members(a.push_constant_members), set_bindings(a.set_bindings), binding_flags(a.binding_flags), stages(a.stages | b.stages) {
     if ((a.stages & b.stages) != 0)
         throw std::runtime_error("Overlap in stages");
     for (auto range_b : b.push_constants) {
-        // TODO: we assume no overlap
-        push_constants.push_back(range_b);
+        // identical ranges are shared between stages, otherwise we rely on each stage only appearing in one range
+        bool merged = false;
+        for (auto& range_a : push_constants) {
+            if (range_a.offset == range_b.offset && range_a.size == range_b.size) {
+                range_a.stageFlags |= range_b.stageFlags;
+                merged = true;
+            }
+        }
+        if (!merged)
+            push_constants.push_back(range_b);
+    }
+    for (auto& member_b : b.push_constant_members) {
+        bool known = false;
+        for (auto& member_a : push_constant_members)
+            known |= member_a.offset == member_b.offset;
+        if (!known)
+            push_constant_members.push_back(member_b);
     }
     // add B to A
     for (auto [set_b, bindings_b] : b.set_bindings) {
@@ -116,6 +249,7 @@ ReflectedLayout::ReflectedLayout(imr::ReflectedLayout& a, imr::ReflectedLayout&
                         if (binding_a.descriptorCount != binding_b.descriptorCount || binding_a.descriptorType != binding_b.descriptorType) {
                             throw std::runtime_error("Incompatible bindings");
                         }
+                        binding_a.stageFlags |= binding_b.stageFlags;
                         merged = true;
                     }
                 }
@@ -126,9 +260,13 @@ ReflectedLayout::ReflectedLayout(imr::ReflectedLayout& a, imr::ReflectedLayout&
             set_bindings[set_b] = bindings_b;
         }
     }
+    for (auto& [set_b, flags_b] : b.binding_flags) {
+        for (auto [binding_b, flags] : flags_b)
+            binding_flags[set_b][binding_b] |= flags;
+    }
 }
 
-PipelineLayout::PipelineLayout(imr::Device& device, imr::ReflectedLayout& reflected_layout) : device(device) {
+PipelineLayout::PipelineLayout(imr::Device& device, imr::ReflectedLayout& reflected_layout, bool allow_push_descriptors, BindlessTable* bindless_table) : device(device) {
     int max_set = 0;
     for (auto& [set, value] : reflected_layout.set_bindings) {
         if (set > max_set)
@@ -136,35 +274,61 @@ PipelineLayout::PipelineLayout(imr::Device& device, imr::ReflectedLayout& reflec
     }
     assert(max_set < 32);
     set_layouts.resize(max_set + 1);
+
+    if (bindless_table && bindless_table->set_index() <= max_set)
+        bindless_set = bindless_table->set_index();
+
     for (unsigned set = 0; set < max_set + 1; set++) {
         auto& bindings = reflected_layout.set_bindings[set];
-        CHECK_VK_THROW(vkCreateDescriptorSetLayout(device.device, tmpPtr((VkDescriptorSetLayoutCreateInfo) {
-            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-            .bindingCount = static_cast<uint32_t>(bindings.size()),
-            .pBindings = bindings.data(),
-        }), nullptr, &set_layouts[set]));
+        if (bindless_set == set) {
+            for (auto& binding : bindings) {
+                bool matches = (binding.binding == BindlessTable::sampled_images_binding && binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                            || (binding.binding == BindlessTable::storage_images_binding && binding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+                if (!matches)
+                    throw std::runtime_error("Shader bindings in the bindless set don't match the BindlessTable layout");
+            }
+            set_layouts[set] = bindless_table->set_layout();
+            continue;
+        }
+
+        std::vector<VkDescriptorBindingFlags> flags;
+        if (reflected_layout.binding_flags.contains(set)) {
+            if (!device.features().descriptor_indexing)
+                throw std::runtime_error("Runtime-sized descriptor arrays need a device with descriptor indexing");
+            auto& set_flags = reflected_layout.binding_flags[set];
+            for (auto& binding : bindings)
+                flags.push_back(set_flags.contains(binding.binding) ? set_flags[binding.binding] : 0);
+        }
+
+        // only one set per layout can be pushed, and it can't have any binding flags
+        VkDescriptorSetLayoutCreateFlags create_flags = 0;
+        if (allow_push_descriptors && device.features().push_descriptor && !push_descriptor_set && flags.empty() && !bindings.empty()) {
+            uint32_t descriptors = 0;
+            for (auto& binding : bindings)
+                descriptors += binding.descriptorCount;
+            if (descriptors <= device._impl->max_push_descriptors) {
+                push_descriptor_set = set;
+                create_flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+            }
+        }
+        set_layouts[set] = device._impl->layouts.get_set_layout(device, bindings, flags, create_flags);
     }
 
-    CHECK_VK_THROW(vkCreatePipelineLayout(device.device, tmpPtr((VkPipelineLayoutCreateInfo) {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = static_cast<uint32_t>(set_layouts.size()),
-        .pSetLayouts = set_layouts.data(),
-        .pushConstantRangeCount = static_cast<uint32_t>(reflected_layout.push_constants.size()),
-        .pPushConstantRanges = reflected_layout.push_constants.data()
-    }), nullptr, &pipeline_layout));
+    pipeline_layout = device._impl->layouts.get_pipeline_layout(device, set_layouts, reflected_layout.push_constants);
 }
 
-PipelineLayout::~PipelineLayout() {
-    vkDestroyPipelineLayout(device.device, pipeline_layout, nullptr);
-    for (auto set_layout : set_layouts)
-        vkDestroyDescriptorSetLayout(device.device, set_layout, nullptr);
-}
+// the layouts belong to the device's LayoutCache
+PipelineLayout::~PipelineLayout() = default;
 
 ShaderModule::ShaderModule(imr::Device& device, std::string&& spirv_filename) noexcept(false) {
     auto spirv_module = load_spirv_module(spirv_filename);
     _impl = std::make_unique<Impl>(device, std::move(spirv_module));
 }
 
+ShaderModule::ShaderModule(imr::Device& device, std::vector<uint32_t>&& spirv) noexcept(false) {
+    _impl = std::make_unique<Impl>(device, std::move(spirv));
+}
+
 ShaderModule::Impl::Impl(imr::Device& device, imr::SPIRVModule&& spirv_module) noexcept(false) : device(device), spirv_module(std::move(spirv_module)) {
     assert(this->spirv_module.size() > 0);
     CHECK_VK(vkCreateShaderModule(device.device, tmpPtr((VkShaderModuleCreateInfo) {
@@ -201,8 +365,40 @@ ShaderEntryPoint::Impl::~Impl() = default;
 
 ShaderEntryPoint::~ShaderEntryPoint() = default;
 
-ComputePipeline::Impl::Impl(imr::Device& device, imr::ShaderEntryPoint& entry_point) : device(device) {
-    layout = std::make_unique<PipelineLayout>(device, *entry_point._impl->reflected);
+static void validate_options(const ComputeCapabilities& caps, const ComputePipelineOptions& options, std::optional<VkExtent3D> workgroup_size) {
+    if (options.required_subgroup_size) {
+        uint32_t size = *options.required_subgroup_size;
+        if (!caps.subgroup_size_control || !(caps.required_subgroup_size_stages & VK_SHADER_STAGE_COMPUTE_BIT))
+            throw std::runtime_error("The device does not support requiring a subgroup size for compute shaders");
+        if (size < caps.min_subgroup_size || size > caps.max_subgroup_size || (size & (size - 1)) != 0)
+            throw std::runtime_error("Required subgroup size " + std::to_string(size) + " is not supported by the device");
+        if (workgroup_size && workgroup_size->width * workgroup_size->height * workgroup_size->depth > size * caps.max_compute_workgroup_subgroups)
+            throw std::runtime_error("The workgroup has more subgroups than the device allows");
+    }
+    if (options.full_subgroups) {
+        if (!caps.compute_full_subgroups)
+            throw std::runtime_error("The device does not support requiring full subgroups");
+        // with a required size the workgroup has to be a multiple of it, otherwise of the largest size the driver could pick
+        uint32_t multiple = options.required_subgroup_size ? *options.required_subgroup_size : caps.max_subgroup_size;
+        if (workgroup_size && workgroup_size->width % multiple != 0)
+            throw std::runtime_error("Full subgroups need the workgroup width to be a multiple of " + std::to_string(multiple));
+    }
+}
+
+ComputePipeline::Impl::Impl(imr::Device& device, imr::ShaderEntryPoint& entry_point, ComputePipelineOptions options) : device(device) {
+    layout = std::make_unique<PipelineLayout>(device, *entry_point._impl->reflected, options.push_descriptors, options.bindless_table);
+
+    auto& reflected = *entry_point._impl->reflected;
+    push_constant_members = reflected.push_constant_members;
+    if (!reflected.push_constants.empty())
+        push_constant_range = reflected.push_constants[0];
+    workgroup_size = reflect_workgroup_size(entry_point._impl->module._impl->spirv_module, entry_point.name());
+    validate_options(device.compute_capabilities(), options, workgroup_size);
+
+    VkPipelineShaderStageRequiredSubgroupSizeCreateInfo required_subgroup_size = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_REQUIRED_SUBGROUP_SIZE_CREATE_INFO,
+        .requiredSubgroupSize = options.required_subgroup_size.value_or(0),
+    };
 
     pipeline = VK_NULL_HANDLE;
     CHECK_VK_THROW(vkCreateComputePipelines(device.device, VK_NULL_HANDLE, 1, tmpPtr((VkComputePipelineCreateInfo) {
@@ -210,7 +406,8 @@ ComputePipeline::Impl::Impl(imr::Device& device, imr::ShaderEntryPoint& entry_po
             .flags = 0,
             .stage = {
                     .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-                    .flags = 0,
+                    .pNext = options.required_subgroup_size ? &required_subgroup_size : nullptr,
+                    .flags = options.full_subgroups ? VK_PIPELINE_SHADER_STAGE_CREATE_REQUIRE_FULL_SUBGROUPS_BIT : 0u,
                     .stage = entry_point.stage(),
                     .module = entry_point._impl->module.vk_shader_module(),
                     .pName = entry_point.name().c_str(),
@@ -219,16 +416,22 @@ ComputePipeline::Impl::Impl(imr::Device& device, imr::ShaderEntryPoint& entry_po
     }), nullptr, &pipeline));
 }
 
-ComputePipeline::Impl::Impl(imr::Device& device, std::unique_ptr<ShaderModule>&& module, std::unique_ptr<ShaderEntryPoint>&& ep) : Impl(device, *ep) {
+ComputePipeline::Impl::Impl(imr::Device& device, std::unique_ptr<ShaderModule>&& module, std::unique_ptr<ShaderEntryPoint>&& ep, ComputePipelineOptions options) : Impl(device, *ep, options) {
     this->module = std::move(module);
     this->entry_point = std::move(ep);
     assert(this->module && this->entry_point);
 }
 
-ComputePipeline::ComputePipeline(imr::Device& device, std::string&& spirv_filename, std::string&& entrypoint_name) {
+ComputePipeline::ComputePipeline(imr::Device& device, std::string&& spirv_filename, std::string&& entrypoint_name, ComputePipelineOptions options) {
     auto shader_module = std::make_unique<ShaderModule>(device, std::move(spirv_filename));
     auto entry_point = std::make_unique<ShaderEntryPoint>(*shader_module, VK_SHADER_STAGE_COMPUTE_BIT, entrypoint_name);
-    _impl = std::make_unique<ComputePipeline::Impl>(device, std::move(shader_module), std::move(entry_point));
+    _impl = std::make_unique<ComputePipeline::Impl>(device, std::move(shader_module), std::move(entry_point), options);
+}
+
+ComputePipeline::ComputePipeline(imr::Device& device, std::vector<uint32_t>&& spirv, std::string&& entrypoint_name, ComputePipelineOptions options) {
+    auto shader_module = std::make_unique<ShaderModule>(device, std::move(spirv));
+    auto entry_point = std::make_unique<ShaderEntryPoint>(*shader_module, VK_SHADER_STAGE_COMPUTE_BIT, entrypoint_name);
+    _impl = std::make_unique<ComputePipeline::Impl>(device, std::move(shader_module), std::move(entry_point), options);
 }
 
 ComputePipeline::Impl::~Impl() {
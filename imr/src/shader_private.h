@@ -7,26 +7,38 @@ namespace imr {
 
 using SPIRVModule = std::vector<uint32_t>;
 SPIRVModule load_spirv_module(const std::string& filename);
+/// Reads the LocalSize execution mode (or the WorkgroupSize built-in, which overrides it) straight from the SPIR-V, nullopt if it is only known at pipeline creation
+std::optional<VkExtent3D> reflect_workgroup_size(const SPIRVModule& spirv_module, const std::string& entry_point);
 
 /// Generates set layouts and pipeline layouts from the SPIR-V module by parsing it as a shady module and using the IR inspection API to find bindings and such
 struct ReflectedLayout {
+    /// Runtime-sized descriptor arrays (`uniform texture2D textures[]`) get this many slots, and are partially bound
+    static constexpr uint32_t runtime_array_size = 256;
+
     VkShaderStageFlags stages;
     std::unordered_map<int, std::vector<VkDescriptorSetLayoutBinding>> set_bindings;
+    /// Only bindings needing flags are present, keyed by set then binding
+    std::unordered_map<int, std::unordered_map<uint32_t, VkDescriptorBindingFlags>> binding_flags;
     std::vector<VkPushConstantRange> push_constants;
+    std::vector<PushConstantMember> push_constant_members;
 
     ReflectedLayout() = default;
     ReflectedLayout(SPIRVModule& spirv_module, VkShaderStageFlags stage);
     ReflectedLayout(ReflectedLayout& a, ReflectedLayout& b);
 };
 
-/// Turns the ReflectedLayout into the VkDescriptorSetLayout s and VkPipelineLayout
+/// Turns the ReflectedLayout into the VkDescriptorSetLayout s and VkPipelineLayout, going through the device's LayoutCache
 struct PipelineLayout {
     imr::Device& device;
 
     std::vector<VkDescriptorSetLayout> set_layouts;
     VkPipelineLayout pipeline_layout;
+    /// Set index whose layout is the one of the BindlessTable the pipeline was created with
+    std::optional<uint32_t> bindless_set;
+    /// Set index whose layout is a push descriptor one
+    std::optional<uint32_t> push_descriptor_set;
 
-    PipelineLayout(imr::Device& device, ReflectedLayout& reflected_layout);
+    PipelineLayout(imr::Device& device, ReflectedLayout& reflected_layout, bool allow_push_descriptors = false, BindlessTable* bindless_table = nullptr);
     ~PipelineLayout();
 };
 
@@ -61,13 +73,21 @@ struct ComputePipeline::Impl {
     std::unique_ptr<ShaderModule> module;
     std::unique_ptr<ShaderEntryPoint> entry_point;
 
-    Impl(imr::Device& device, std::unique_ptr<ShaderModule>&& module, std::unique_ptr<ShaderEntryPoint>&& ep);
-    Impl(imr::Device& device, ShaderEntryPoint& entry_point);
+    std::vector<PushConstantMember> push_constant_members;
+    std::optional<VkPushConstantRange> push_constant_range;
+    std::optional<VkExtent3D> workgroup_size;
+
+    /// What dispatch() last pushed, only meaningful for `pushed_cmdbuf`
+    VkCommandBuffer pushed_cmdbuf = VK_NULL_HANDLE;
+    std::vector<uint8_t> pushed;
+
+    Impl(imr::Device& device, std::unique_ptr<ShaderModule>&& module, std::unique_ptr<ShaderEntryPoint>&& ep, ComputePipelineOptions options);
+    Impl(imr::Device& device, ShaderEntryPoint& entry_point, ComputePipelineOptions options);
     ~Impl();
 };
 
 struct GraphicsPipeline::Impl {
-    Impl(Device& device, std::vector<ShaderEntryPoint*>&& stages, RenderTargetsState, StateBuilder);
+    Impl(Device& device, std::vector<ShaderEntryPoint*>&& stages, RenderTargetsState, StateBuilder, BindlessTable* bindless_table);
 
     ~Impl();
 
@@ -0,0 +1,93 @@
+#include "imr_private.h"
+
+namespace imr {
+
+static void append(SubmitBatch& batch, const VkSubmitInfo& info) {
+    // without waits in between, command buffers can simply join the previous submission
+    if (batch.submissions.empty() || info.waitSemaphoreCount > 0 || !batch.submissions.back().signals.empty())
+        batch.submissions.emplace_back();
+    auto& submission = batch.submissions.back();
+
+    for (uint32_t i = 0; i < info.waitSemaphoreCount; i++) {
+        submission.waits.push_back({
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = info.pWaitSemaphores[i],
+            .stageMask = info.pWaitDstStageMask[i],
+        });
+    }
+    for (uint32_t i = 0; i < info.commandBufferCount; i++) {
+        submission.command_buffers.push_back({
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+            .commandBuffer = info.pCommandBuffers[i],
+        });
+    }
+    for (uint32_t i = 0; i < info.signalSemaphoreCount; i++) {
+        submission.signals.push_back({
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = info.pSignalSemaphores[i],
+            .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        });
+    }
+}
+
+/// Expects main_queue_mutex to be held
+static VkResult flush(Device& device, SubmitBatch& batch) {
+    if (batch.submissions.empty() && !batch.fence)
+        return VK_SUCCESS;
+
+    std::vector<VkSubmitInfo2> infos;
+    for (auto& submission : batch.submissions) {
+        infos.push_back({
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+            .waitSemaphoreInfoCount = static_cast<uint32_t>(submission.waits.size()),
+            .pWaitSemaphoreInfos = submission.waits.data(),
+            .commandBufferInfoCount = static_cast<uint32_t>(submission.command_buffers.size()),
+            .pCommandBufferInfos = submission.command_buffers.data(),
+            .signalSemaphoreInfoCount = static_cast<uint32_t>(submission.signals.size()),
+            .pSignalSemaphoreInfos = submission.signals.data(),
+        });
+    }
+    VkResult result = device.dispatch.queueSubmit2KHR(device.main_queue, static_cast<uint32_t>(infos.size()), infos.data(), batch.fence);
+
+    batch.submissions.clear();
+    batch.fence = VK_NULL_HANDLE;
+    return result;
+}
+
+/// Expects main_queue_mutex to be held
+static VkResult enqueue(Device& device, SubmitBatch& batch, const VkSubmitInfo& info, VkFence fence) {
+    if (fence && batch.fence) {
+        if (VkResult result = flush(device, batch); result != VK_SUCCESS)
+            return result;
+    }
+    append(batch, info);
+    if (fence)
+        batch.fence = fence;
+    return VK_SUCCESS;
+}
+
+VkResult Device::submit(const VkSubmitInfo& info, VkFence fence) {
+    std::lock_guard lock(_impl->main_queue_mutex);
+    if (VkResult result = enqueue(*this, _impl->pending_submits, info, fence); result != VK_SUCCESS)
+        return result;
+    return flush(*this, _impl->pending_submits);
+}
+
+VkResult Device::present(const VkPresentInfoKHR& info) {
+    std::lock_guard lock(_impl->main_queue_mutex);
+    if (VkResult result = flush(*this, _impl->pending_submits); result != VK_SUCCESS)
+        return result;
+    return vkQueuePresentKHR(main_queue, &info);
+}
+
+VkResult Device::enqueueSubmit(const VkSubmitInfo& info, VkFence fence) {
+    std::lock_guard lock(_impl->main_queue_mutex);
+    return enqueue(*this, _impl->pending_submits, info, fence);
+}
+
+VkResult Device::flushSubmits() {
+    std::lock_guard lock(_impl->main_queue_mutex);
+    return flush(*this, _impl->pending_submits);
+}
+
+}
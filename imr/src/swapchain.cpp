@@ -85,7 +85,13 @@ void Swapchain::Impl::build_swapchain() {
     }
 
     int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
+    if (glfw_on_other_thread) {
+        uint64_t size = framebuffer_size;
+        width = int(size >> 32);
+        height = int(size & 0xFFFFFFFF);
+    } else {
+        glfwGetFramebufferSize(window, &width, &height);
+    }
 
     auto builder = vkb::SwapchainBuilder(device.physical_device, device.device, surface);
     builder.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
@@ -109,6 +115,8 @@ void Swapchain::Impl::build_swapchain() {
 
 void Swapchain::Impl::destroy_swapchain() {
     slots.clear();
+    // the format could change along with the swapchain
+    upscaler.reset();
     vkb::destroy_swapchain(swapchain);
 }
 
@@ -122,6 +130,9 @@ VkFormat Swapchain::format() const {
     return _impl->swapchain.image_format;
 }
 
+/// How long an acquire may hold the swapchain while a present thread is waiting for it
+static constexpr uint64_t acquire_timeout_ns = 1000000;
+
 /// Acquires the next image
 std::optional<std::tuple<SwapchainSlot&, VkSemaphore>> nextSwapchainSlot(Swapchain::Impl* _impl) {
     auto& device = _impl->device;
@@ -146,7 +157,12 @@ std::optional<std::tuple<SwapchainSlot&, VkSemaphore>> nextSwapchainSlot(Swapcha
         .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
     }), nullptr, &fence));
 
-    VkResult acquire_result = device.dispatch.acquireNextImageKHR(_impl->swapchain, UINT64_MAX, image_acquired_semaphore, fence, &image_index);
+    VkResult acquire_result;
+    do {
+        // the present thread may be sitting on the image we'd wait for, and needs the swapchain to present it
+        std::lock_guard lock(_impl->swapchain_mutex);
+        acquire_result = device.dispatch.acquireNextImageKHR(_impl->swapchain, _impl->present_thread ? acquire_timeout_ns : UINT64_MAX, image_acquired_semaphore, fence, &image_index);
+    } while (acquire_result == VK_TIMEOUT || acquire_result == VK_NOT_READY);
     switch (acquire_result) {
         case VK_SUCCESS: break;
         case VK_SUBOPTIMAL_KHR: _impl->should_resize = true; break;
@@ -190,7 +206,13 @@ void Swapchain::resize() {
 
 void Swapchain::drain() {
     auto& device = _impl->device;
-    vkDeviceWaitIdle(device.device);
+    if (_impl->present_thread)
+        _impl->present_thread->wait_idle();
+    CHECK_VK_THROW(device.flushSubmits());
+    {
+        std::lock_guard lock(device._impl->main_queue_mutex);
+        vkDeviceWaitIdle(device.device);
+    }
 
     for (auto& slot : _impl->slots) {
         if (slot->frame && slot->frame->_impl->submitted)
@@ -201,6 +223,7 @@ void Swapchain::drain() {
 
 Swapchain::~Swapchain() {
     drain();
+    _impl->present_thread.reset();
 
     _impl->destroy_swapchain();
     _impl.reset();
@@ -3,10 +3,78 @@
 
 #include "imr_private.h"
 
+#include <atomic>
+#include <thread>
+
 namespace imr {
 
 struct SwapchainSlot;
 
+/// Backs Swapchain::renderFrameFromHost for one slot, lives as long as the slot's swapchain image
+struct HostFramebuffer {
+    Device& device;
+    std::unique_ptr<Buffer> buffer;
+    uint8_t* mapped;
+    /// Copies `buffer` into the slot's image and leaves it ready to present, recorded once and resubmitted every time
+    VkCommandBuffer copy_cmdbuf;
+    VkFence copy_done;
+
+    HostFramebuffer(Device&, VkImage image, VkExtent2D size, VkFormat format);
+    HostFramebuffer(HostFramebuffer&) = delete;
+    ~HostFramebuffer();
+};
+
+/// Pipelines and scratch image behind Swapchain::Frame::presentUpscaled, created on first use
+struct Upscaler {
+    Device& device;
+    /// Whether the swapchain images can be written from compute
+    bool supported;
+    std::unique_ptr<ComputePipeline> easu;
+    std::unique_ptr<ComputePipeline> rcas;
+    /// EASU's output at the swapchain's size, shared by all frames since they run in submission order on the same queue
+    std::unique_ptr<Image> intermediate;
+
+    Upscaler(Device&, VkFormat swapchain_format);
+    Upscaler(Upscaler&) = delete;
+    ~Upscaler();
+};
+
+/// Everything needed to present a slot's image, without referring to the frame
+struct PresentRequest {
+    VkSwapchainKHR swapchain;
+    uint32_t image_index;
+    VkSemaphore wait;
+    /// Empty when the whole image changed
+    std::vector<VkRectLayerKHR> rects;
+    bool quit = false;
+};
+
+/// Presents on behalf of Swapchain::Frame::queuePresent when Swapchain::asyncPresent is set.
+/// Requests go through a single-producer, single-consumer ring so handing over a frame never takes a lock.
+struct PresentThread {
+    static constexpr uint32_t capacity = 8;
+
+    Swapchain::Impl& swapchain;
+    PresentRequest ring[capacity];
+    /// Next request to present, only advanced by the present thread
+    std::atomic<uint32_t> head = 0;
+    /// Next free entry, only advanced by the thread queueing presents
+    std::atomic<uint32_t> tail = 0;
+    /// The first unexpected present result, rethrown from the next queuePresent
+    std::atomic<VkResult> error = VK_SUCCESS;
+    std::thread thread;
+
+    PresentThread(Swapchain::Impl&);
+    PresentThread(PresentThread&) = delete;
+    ~PresentThread();
+
+    /// Blocks only if the ring is full
+    void push(PresentRequest&&);
+    /// Returns once everything pushed so far has been presented
+    void wait_idle();
+    void run();
+};
+
 struct Swapchain::Impl {
     Swapchain& parent;
     Device& device;
@@ -18,13 +86,24 @@ struct Swapchain::Impl {
     size_t frame_counter = 0;
 
     uint64_t last_present = 0;
-    bool should_resize = false;
+    std::atomic<bool> should_resize = false;
+
+    /// Set while a FrameLoop renders from its own thread: GLFW may only be called from the main thread, which reports the framebuffer size here instead
+    std::atomic<bool> glfw_on_other_thread = false;
+    std::atomic<uint64_t> framebuffer_size = 0;
 
     vkb::Swapchain swapchain;
     std::vector<std::unique_ptr<SwapchainSlot>> slots;
+    std::unique_ptr<Upscaler> upscaler;
+
+    /// Acquiring and presenting both need exclusive access to `swapchain`
+    std::mutex swapchain_mutex;
+    std::unique_ptr<PresentThread> present_thread;
 
     void build_swapchain();
     void destroy_swapchain();
+    /// Throttles to Swapchain::maxFps, then presents
+    VkResult present(const PresentRequest&);
 };
 
 struct SwapchainSlot {
@@ -39,6 +118,13 @@ struct SwapchainSlot {
     VkSemaphore present_semaphore;
     VkFence wait_for_previous_present = VK_NULL_HANDLE;
 
+    /// Whether the image holds a complete earlier frame, which is then only `stale_regions` away from being current
+    bool contents_valid = false;
+    /// Regions other slots' frames changed since this image was last presented
+    std::vector<VkRect2D> stale_regions;
+
+    /// Declared before `frame`, whose destruction waits on its fence
+    std::unique_ptr<HostFramebuffer> host_framebuffer;
     std::unique_ptr<Swapchain::Frame> frame = nullptr;
 
     ~SwapchainSlot();
@@ -57,6 +143,11 @@ struct Swapchain::Frame::Impl {
 
     std::vector<VkFence> cleanup_fences;
     std::vector<std::function<void(void)>> cleanup_queue;
+
+    /// Empty when the whole frame changed
+    std::vector<VkRect2D> dirty_regions;
+    /// Regions the image must be refreshed in before presenting, or nullopt if it needs all of it
+    std::optional<std::vector<VkRect2D>> regions_to_refresh() const;
 };
 
 std::optional<std::tuple<SwapchainSlot&, VkSemaphore>> nextSwapchainSlot(Swapchain::Impl* _impl);
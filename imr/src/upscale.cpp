@@ -0,0 +1,187 @@
+#include "swapchain_private.h"
+
+#include <cmath>
+
+// generated by glslang from src/kernels/
+#include "upscale_easu.spv.h"
+#include "upscale_rcas.spv.h"
+
+namespace imr {
+
+/// Needs to hold the source's precision between the two passes, and is always usable as a storage image
+static constexpr VkFormat intermediate_format = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+Upscaler::Upscaler(Device& device, VkFormat swapchain_format) : device(device) {
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(device.physical_device, swapchain_format, &properties);
+    supported = properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+    if (!supported)
+        return;
+    ComputePipelineOptions options = { .push_descriptors = true };
+    easu = std::make_unique<ComputePipeline>(device, embedded_spirv(imr_upscale_easu_spv), "main", options);
+    rcas = std::make_unique<ComputePipeline>(device, embedded_spirv(imr_upscale_rcas_spv), "main", options);
+}
+
+Upscaler::~Upscaler() = default;
+
+void Swapchain::Frame::presentUpscaled(Image& image, VkFence signal_when_reusable, std::optional<VkSemaphore> sem, std::optional<VkExtent2D> image_size, float sharpness_stops) {
+    auto& slot = _impl->slot;
+    auto& swapchain = slot.swapchain;
+    auto& device = _impl->device;
+    auto& vk = device.dispatch;
+
+    if (!swapchain._impl->upscaler)
+        swapchain._impl->upscaler = std::make_unique<Upscaler>(device, swapchain.format());
+    auto& upscaler = *swapchain._impl->upscaler;
+    if (!upscaler.supported)
+        return presentFromImage(image.handle(), signal_when_reusable, sem, VK_IMAGE_LAYOUT_GENERAL, image_size);
+
+    assert(signal_when_reusable != VK_NULL_HANDLE);
+
+    VkExtent2D src_size = image_size.value_or((VkExtent2D) { image.size().width, image.size().height });
+    VkExtent2D dst_size = swapchain._impl->swapchain.extent;
+    // swapchain rebuilds drain the device first, so nothing can still be using the old one
+    if (!upscaler.intermediate || upscaler.intermediate->size().width != dst_size.width || upscaler.intermediate->size().height != dst_size.height)
+        upscaler.intermediate = std::make_unique<Image>(device, VK_IMAGE_TYPE_2D, (VkExtent3D) { dst_size.width, dst_size.height, 1 }, intermediate_format, VK_IMAGE_USAGE_STORAGE_BIT);
+    auto& intermediate = *upscaler.intermediate;
+    auto& target = this->image();
+
+    std::vector<VkSemaphore> semaphores;
+    semaphores.push_back(swapchain_image_available);
+    if (sem)
+        semaphores.push_back(*sem);
+
+    VkCommandBuffer cmdbuf;
+    CHECK_VK_THROW(vkAllocateCommandBuffers(device.device, tmpPtr((VkCommandBufferAllocateInfo) {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = device.pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    }), &cmdbuf));
+
+    CHECK_VK_THROW(vkBeginCommandBuffer(cmdbuf, tmpPtr((VkCommandBufferBeginInfo) {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    })));
+
+    // the source was written by earlier work, the intermediate might still be read by the previous frame's sharpening pass
+    VkImageMemoryBarrier2 to_general[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_2_NONE,
+            .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .image = intermediate.handle(),
+            .subresourceRange = intermediate.whole_image_subresource_range(),
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_2_NONE,
+            .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .image = target.handle(),
+            .subresourceRange = target.whole_image_subresource_range(),
+        },
+    };
+    vk.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = tmpPtr((VkMemoryBarrier2) {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            .srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+        }),
+        .imageMemoryBarrierCount = 2,
+        .pImageMemoryBarriers = to_general,
+    }));
+
+    upscaler.easu->bind(cmdbuf);
+    auto easu_bindings = upscaler.easu->create_bind_helper();
+    easu_bindings->set_storage_image(0, 0, image);
+    easu_bindings->set_storage_image(0, 1, intermediate);
+    easu_bindings->commit(cmdbuf);
+    struct {
+        int32_t source_size[2];
+        int32_t destination_size[2];
+    } easu_constants = {
+        { (int32_t) src_size.width, (int32_t) src_size.height },
+        { (int32_t) dst_size.width, (int32_t) dst_size.height },
+    };
+    upscaler.easu->dispatch(cmdbuf, easu_constants, { dst_size.width, dst_size.height, 1 });
+
+    vk.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = tmpPtr((VkMemoryBarrier2) {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+        }),
+    }));
+
+    upscaler.rcas->bind(cmdbuf);
+    auto rcas_bindings = upscaler.rcas->create_bind_helper();
+    rcas_bindings->set_storage_image(0, 0, intermediate);
+    rcas_bindings->set_storage_image(0, 1, target);
+    rcas_bindings->commit(cmdbuf);
+    struct {
+        int32_t size[2];
+        float sharpness;
+    } rcas_constants = {
+        { (int32_t) dst_size.width, (int32_t) dst_size.height },
+        std::exp2(-sharpness_stops),
+    };
+    upscaler.rcas->dispatch(cmdbuf, rcas_constants, { dst_size.width, dst_size.height, 1 });
+
+    vk.cmdPipelineBarrier2KHR(cmdbuf, tmpPtr((VkDependencyInfo) {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = tmpPtr((VkImageMemoryBarrier2) {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+            .dstAccessMask = VK_ACCESS_2_NONE,
+            .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            .image = target.handle(),
+            .subresourceRange = target.whole_image_subresource_range(),
+        }),
+    }));
+
+    std::vector<VkPipelineStageFlags> stage_flags;
+    for (auto& sem : semaphores)
+        stage_flags.emplace_back(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    CHECK_VK_THROW(vkEndCommandBuffer(cmdbuf));
+    CHECK_VK_THROW(device.enqueueSubmit((VkSubmitInfo) {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .waitSemaphoreCount = static_cast<uint32_t>(semaphores.size()),
+        .pWaitSemaphores = semaphores.data(),
+        .pWaitDstStageMask = stage_flags.data(),
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmdbuf,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &slot.present_semaphore,
+    }, signal_when_reusable));
+
+    addCleanupAction([=, &device]() {
+        delete easu_bindings;
+        delete rcas_bindings;
+        vkFreeCommandBuffers(device.device, device.pool, 1, &cmdbuf);
+    });
+
+    queuePresent();
+}
+
+}